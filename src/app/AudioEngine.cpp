@@ -65,8 +65,8 @@ namespace e3 {
 		AudioProcessor::setTypeOfNextNewPlugin( AudioProcessor::wrapperType_Undefined );
 
 		processor_->setPlayConfigDetails(
-			JucePlugin_MaxNumInputChannels,
-			JucePlugin_MaxNumOutputChannels,
+			NUMINPUTS,
+			NUMOUTPUTS,
 			44100, 512 );
 	}
 
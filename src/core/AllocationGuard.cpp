@@ -0,0 +1,109 @@
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <e3_Exception.h>
+#include "core/AudioTrace.h"
+#include "core/AllocationGuard.h"
+
+#ifdef _MSC_VER
+#define E3_THREAD_LOCAL __declspec(thread)
+#else
+#define E3_THREAD_LOCAL thread_local
+#endif
+
+
+namespace e3 {
+
+    namespace {
+        E3_THREAD_LOCAL int guardDepth = 0;         // nested guards on this thread
+        std::atomic< int > numAllocations( 0 );
+        std::atomic< bool > assertOnAllocation( false );
+    }
+
+
+    AllocationGuard::AllocationGuard()
+    {
+        guardDepth++;
+    }
+
+
+    AllocationGuard::~AllocationGuard()
+    {
+        guardDepth--;
+    }
+
+
+    bool AllocationGuard::isGuarded()
+    {
+        return guardDepth > 0;
+    }
+
+
+    int AllocationGuard::getNumAllocations()
+    {
+        return numAllocations.load();
+    }
+
+
+    void AllocationGuard::resetNumAllocations()
+    {
+        numAllocations.store( 0 );
+    }
+
+
+    void AllocationGuard::setAssertOnAllocation( bool value )
+    {
+        assertOnAllocation.store( value );
+    }
+
+
+    void AllocationGuard::onAllocation( size_t size )
+    {
+        if (guardDepth <= 0) return;
+
+        numAllocations++;
+
+        AUDIO_TRACE( AudioTraceError, TraceAllocation, (double)size, 0 );
+
+        int depth  = guardDepth;                    // a failed assertion may allocate itself
+        guardDepth = 0;
+        ASSERT( assertOnAllocation.load() == false );
+        guardDepth = depth;
+    }
+
+} // namespace e3
+
+
+#ifdef E3_ALLOCATION_GUARD
+
+void* operator new( std::size_t size )
+{
+    e3::AllocationGuard::onAllocation( size );
+
+    void* p = std::malloc( size > 0 ? size : 1 );
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+
+void* operator new[]( std::size_t size )
+{
+    return operator new( size );
+}
+
+
+void operator delete( void* p ) throw()
+{
+    std::free( p );
+}
+
+
+void operator delete[]( void* p ) throw()
+{
+    std::free( p );
+}
+
+#endif // E3_ALLOCATION_GUARD
@@ -0,0 +1,42 @@
+
+#pragma once
+
+#include <cstddef>
+
+
+// Debug and test builds replace the global operator new to find allocations on the audio thread.
+#if defined(_DEBUG) || defined(UNITTEST)
+#define E3_ALLOCATION_GUARD 1
+#endif
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class AllocationGuard
+    // Marks a scope with real-time requirements on the current thread, i.e.
+    // Processor::processBlock(). With E3_ALLOCATION_GUARD defined, every
+    // operator new inside a guarded scope is counted and traced, and fails an
+    // ASSERT if setAssertOnAllocation() is on. Otherwise nothing is tracked.
+    //--------------------------------------------------------------------------
+
+    class AllocationGuard
+    {
+    public:
+        AllocationGuard();
+        ~AllocationGuard();
+
+        static bool isGuarded();
+        static int getNumAllocations();
+        static void resetNumAllocations();
+        static void setAssertOnAllocation( bool value );
+
+        // Called by operator new.
+        static void onAllocation( size_t size );
+
+    private:
+        AllocationGuard( const AllocationGuard& );
+        AllocationGuard& operator=( const AllocationGuard& );
+    };
+
+} // namespace e3
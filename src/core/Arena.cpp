@@ -0,0 +1,79 @@
+
+#include <algorithm>
+#include <e3_Exception.h>
+#include "core/Arena.h"
+
+
+namespace e3 {
+
+    Arena::Arena( size_t capacity )
+    {
+        if (capacity > 0) {
+            addBlock( capacity );
+        }
+    }
+
+
+    Arena::~Arena()
+    {
+        freeBlocks();
+    }
+
+
+    void Arena::reset()
+    {
+        if (blocks_.size() > 1)
+        {
+            size_t capacity = capacity_;
+            freeBlocks();
+            addBlock( capacity );
+        }
+        offset_ = 0;
+        used_   = 0;
+    }
+
+
+    void* Arena::allocateBytes( size_t bytes )
+    {
+        bytes = (bytes + Alignment - 1) & ~(Alignment - 1);     // keep the next allocation aligned
+
+        if (blocks_.empty() || offset_ + bytes > blocks_.back().size) {
+            addBlock( std::max<size_t>( bytes, capacity_ ) );   // at least double the capacity
+        }
+
+        char* data = blocks_.back().begin + offset_;
+        offset_   += bytes;
+        used_     += bytes;
+
+        ASSERT( ((uintptr_t)data & (Alignment - 1)) == 0 );
+        return data;
+    }
+
+
+    void Arena::addBlock( size_t bytes )
+    {
+        bytes = std::max<size_t>( bytes, Alignment );
+
+        Block block;
+        block.memory = new char[bytes + Alignment - 1];
+        block.begin  = (char*)(((uintptr_t)block.memory + Alignment - 1) & ~(uintptr_t)(Alignment - 1));
+        block.size   = bytes;
+
+        blocks_.push_back( block );
+        capacity_ += bytes;
+        offset_    = 0;
+    }
+
+
+    void Arena::freeBlocks()
+    {
+        for (size_t i = 0; i < blocks_.size(); i++) {
+            delete[] blocks_[i].memory;
+        }
+        blocks_.clear();
+        capacity_ = 0;
+        offset_   = 0;
+        used_     = 0;
+    }
+
+} // namespace e3
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class Arena
+    // Bump allocator for the DSP state of an Instrument.
+    // Allocations are aligned to a cache line, which also satisfies all SIMD
+    // widths, and are laid out in the order they are requested.
+    // Memory is never freed individually. reset() releases everything at once.
+    //--------------------------------------------------------------------------
+
+    class Arena
+    {
+    public:
+        enum { Alignment = 64 };
+
+        Arena( size_t capacity = 0 );
+        ~Arena();
+
+        // Returns memory for size elements of type T, initialized with value.
+        template< class T > T* allocate( size_t size, T value = T() );
+
+        // Releases all allocations. If the arena had to grow since the last reset,
+        // the blocks are merged into one, so the next layout is contiguous again.
+        void reset();
+
+        size_t getUsed() const        { return used_; }
+        size_t getCapacity() const    { return capacity_; }
+        size_t getNumBlocks() const   { return blocks_.size(); }
+
+    protected:
+        void* allocateBytes( size_t bytes );
+        void addBlock( size_t bytes );
+        void freeBlocks();
+
+        struct Block
+        {
+            char* memory;       // as returned by new[]
+            char* begin;        // aligned start
+            size_t size;
+        };
+
+        std::vector< Block > blocks_;
+        size_t offset_   = 0;         // offset into the last block
+        size_t used_     = 0;
+        size_t capacity_ = 0;
+
+    private:
+        Arena( const Arena& ) = delete;
+        Arena& operator=( const Arena& ) = delete;
+    };
+
+
+    template< class T >
+    inline T* Arena::allocate( size_t size, T value )
+    {
+        T* data = static_cast<T*>(allocateBytes( size * sizeof( T ) ));
+        for (size_t i = 0; i < size; i++) {
+            data[i] = value;
+        }
+        return data;
+    }
+
+} // namespace e3
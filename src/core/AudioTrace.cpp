@@ -0,0 +1,114 @@
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <e3_Trace.h>
+#include "JuceHeader.h"
+#include "core/LockFreeRing.h"
+#include "core/AudioTrace.h"
+
+
+namespace e3 {
+
+    namespace {
+
+        LockFreeRing< AudioTraceRecord, AudioTrace::Capacity > ring;
+
+#if E3_AUDIO_TRACE_LEVEL > 0
+        std::mutex threadLock;                  // message thread only
+        std::thread drainThread;
+        std::atomic< bool > running( false );
+        int numStarted = 0;
+
+        void drainLoop()
+        {
+            while (running.load())
+            {
+                AudioTrace::drain();
+                std::this_thread::sleep_for( std::chrono::milliseconds( AudioTrace::DrainInterval ) );
+            }
+        }
+#endif
+
+        const char* names[NumTracePoints] = {
+            "midi message",
+            "voice steal",
+            "voice limit",
+            "allocation",
+            "input dropped",
+            "stream underrun"
+        };
+    }
+
+
+    // Without trace points there is nothing to drain, so no thread is started.
+    //
+    void AudioTrace::start()
+    {
+#if E3_AUDIO_TRACE_LEVEL > 0
+        std::lock_guard< std::mutex > lock( threadLock );
+        if (numStarted++ == 0)
+        {
+            running.store( true );
+            drainThread = std::thread( drainLoop );
+        }
+#endif
+    }
+
+
+    void AudioTrace::stop()
+    {
+#if E3_AUDIO_TRACE_LEVEL > 0
+        std::lock_guard< std::mutex > lock( threadLock );
+        if (numStarted > 0 && --numStarted == 0)
+        {
+            running.store( false );
+            drainThread.join();
+            drain();
+        }
+#endif
+    }
+
+
+    void AudioTrace::push( AudioTracePoint point, double value1, double value2 )
+    {
+        AudioTraceRecord record;
+        record.ticks  = Time::getHighResolutionTicks();
+        record.point  = point;
+        record.value1 = value1;
+        record.value2 = value2;
+
+        ring.push( record );
+    }
+
+
+    bool AudioTrace::pop( AudioTraceRecord& record )
+    {
+        return ring.pop( record );
+    }
+
+
+    void AudioTrace::drain()
+    {
+        AudioTraceRecord record;
+        while (ring.pop( record ))
+        {
+            double msec = Time::highResolutionTicksToSeconds( record.ticks ) * 1000;
+            TRACE( "[audio %.3f] %s: %g %g\n", msec, getName( record.point ), record.value1, record.value2 );
+        }
+    }
+
+
+    int AudioTrace::getNumDropped()
+    {
+        return ring.getNumDropped();
+    }
+
+
+    const char* AudioTrace::getName( AudioTracePoint point )
+    {
+        return (point >= 0 && point < NumTracePoints) ? names[point] : "unknown";
+    }
+
+} // namespace e3
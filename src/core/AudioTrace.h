@@ -0,0 +1,84 @@
+
+#pragma once
+
+#include <cstdint>
+
+
+// Compile-time filter for the trace points on the audio thread:
+// 0 none, 1 errors, 2 events, 3 verbose. Release builds trace nothing.
+#ifndef E3_AUDIO_TRACE_LEVEL
+#if defined(_DEBUG) || defined(_TRACE)
+#define E3_AUDIO_TRACE_LEVEL 2
+#else
+#define E3_AUDIO_TRACE_LEVEL 0
+#endif
+#endif
+
+
+namespace e3 {
+
+    enum AudioTraceLevel {
+        AudioTraceError   = 1,
+        AudioTraceEvent   = 2,
+        AudioTraceVerbose = 3
+    };
+
+
+    enum AudioTracePoint {
+        TraceMidiMessage = 0,       // status byte, data bytes
+        TraceVoiceSteal  = 1,       // stolen voice, pitch of the new note
+        TraceVoiceLimit  = 2,       // cpu load in percent, number of voices
+        TraceAllocation  = 3,       // bytes
+        TraceInputDropped = 4,      // samples of the block, capacity of the input buffer
+        TraceStreamUnderrun = 5,    // voice, frame of the sample that was not streamed in time
+        NumTracePoints
+    };
+
+
+    struct AudioTraceRecord
+    {
+        int64_t ticks = 0;
+        AudioTracePoint point = TraceMidiMessage;
+        double value1 = 0;
+        double value2 = 0;
+    };
+
+
+    //--------------------------------------------------------------------------
+    // class AudioTrace
+    // Tracing for the audio thread. AUDIO_TRACE writes a binary record into a
+    // lock-free ring, a background thread drains the ring and formats the
+    // records with TRACE. Trace points above E3_AUDIO_TRACE_LEVEL compile to
+    // nothing. Records are dropped while the ring is full.
+    //--------------------------------------------------------------------------
+
+    class AudioTrace
+    {
+    public:
+        enum {
+            Capacity      = 1024,       // must be a power of two
+            DrainInterval = 50          // msec
+        };
+
+        // Message thread. Each start() needs a stop(), the first starts the background thread.
+        static void start();
+        static void stop();
+
+        // Any thread, lock-free.
+        static void push( AudioTracePoint point, double value1, double value2 );
+        static bool pop( AudioTraceRecord& record );
+
+        static void drain();
+        static int getNumDropped();
+        static const char* getName( AudioTracePoint point );
+    };
+
+} // namespace e3
+
+
+#if E3_AUDIO_TRACE_LEVEL > 0
+#define AUDIO_TRACE( level, point, value1, value2 ) \
+    do { if ((level) <= E3_AUDIO_TRACE_LEVEL) e3::AudioTrace::push( (point), (value1), (value2) ); } while (0)
+#else
+#define AUDIO_TRACE( level, point, value1, value2 ) ((void)0)
+#endif
@@ -0,0 +1,207 @@
+
+#include <cmath>
+#include <algorithm>
+#include <e3_Exception.h>
+#include <e3_Trace.h>
+#include "core/Preset.h"
+#include "core/ControllerMap.h"
+
+
+namespace e3 {
+
+    ControllerMap::ControllerMap()
+    {
+        clear();
+    }
+
+
+    void ControllerMap::clear()
+    {
+        targets_.clear();
+        slots_.clear();
+        nrpns_.clear();
+        targetIndex_.clear();
+
+        for (int c = 0; c < NumChannels; c++)
+        {
+            std::fill_n( controllers_[c], NumControllers, Range() );
+            std::fill_n( msb_[c], 32, 0 );
+            nrpn_[c]    = -1;
+            dataMsb_[c] = 0;
+        }
+    }
+
+
+    void ControllerMap::compile( const Preset& preset )
+    {
+        clear();
+        addParameters( preset.getModuleParameters() );
+        addParameters( preset.getLinkParameters() );
+
+        // one entry per channel and controller id, sorted so each controller owns a contiguous slot range
+        struct Entry { int channel; int controllerId; int target; };
+        std::vector< Entry > entries;
+
+        for (size_t i = 0; i < targets_.size(); i++)
+        {
+            const MidiParameterShaper& controller = targets_[i].controller;
+            int channel = controller.getControllerChannel();
+            for (int c = 0; c < NumChannels; c++)
+            {
+                if (channel < 0 || channel == c) {
+                    Entry entry = { c, controller.getControllerId(), (int)i };
+                    entries.push_back( entry );
+                }
+            }
+        }
+        std::sort( entries.begin(), entries.end(), []( const Entry& a, const Entry& b ) {
+            return a.channel != b.channel ? a.channel < b.channel : a.controllerId < b.controllerId;
+        } );
+
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const Entry& entry = entries[i];
+            Range& range = (entry.controllerId < NumControllers) ?
+                controllers_[entry.channel][entry.controllerId] :
+                nrpns_[(entry.channel << 14) | (entry.controllerId - MidiParameterShaper::ControllerNrpn)];
+
+            if (range.count == 0) {
+                range.first = (int)slots_.size();
+            }
+            range.count++;
+            slots_.push_back( entry.target );
+        }
+    }
+
+
+    void ControllerMap::addParameters( const ParameterSet& parameters )
+    {
+        for (ParameterSet::const_iterator it = parameters.begin(); it != parameters.end(); ++it)
+        {
+            const Parameter& parameter = *it;
+            int id = parameter.midiShaper_.getControllerId();
+            if (id < 0) continue;
+
+            bool valid = id < MidiParameterShaper::Controller14Bit + 32 ||
+                (id >= MidiParameterShaper::ControllerNrpn && id < MidiParameterShaper::ControllerNrpn + 16384);
+            if (valid == false) {
+                TRACE( "ControllerMap::addParameters: invalid controller id %d for parameter %d of module %d\n",
+                    id, parameter.getId(), parameter.getModuleId() );
+                continue;
+            }
+
+            Target target;
+            target.change     = ParameterChange( parameter, parameter.value_ );
+            target.controller = parameter.midiShaper_;
+            target.range      = parameter.valueShaper_;
+            target.value      = parameter.value_;
+            target.accepted   = parameter.midiShaper_.getSoftTakeover() == false;
+
+            targetIndex_[makeKey( parameter.getModuleId(), parameter.getId(), parameter.isLinkType() )] = (int)targets_.size();
+            targets_.push_back( target );
+        }
+    }
+
+
+    bool ControllerMap::matches( const Parameter& parameter ) const
+    {
+        const MidiParameterShaper& shaper = parameter.midiShaper_;
+        std::unordered_map< int64_t, int >::const_iterator pos = targetIndex_.find( makeKey( parameter.getModuleId(), parameter.getId(), parameter.isLinkType() ) );
+        if (pos == targetIndex_.end()) {
+            return shaper.getControllerId() < 0;
+        }
+
+        const MidiParameterShaper& controller = targets_[pos->second].controller;
+        return
+            controller.getControllerId() == shaper.getControllerId() &&
+            controller.getControllerChannel() == shaper.getControllerChannel() &&
+            controller.getControllerMin() == shaper.getControllerMin() &&
+            controller.getControllerMax() == shaper.getControllerMax() &&
+            controller.getSoftTakeover() == shaper.getSoftTakeover();
+    }
+
+
+    void ControllerMap::handleController( int channel, int number, int value, Instrument* instrument, ParameterQueue* queue )
+    {
+        ASSERT( channel >= 0 && channel < NumChannels );
+        ASSERT( number >= 0 && number < 128 );
+
+        dispatch( controllers_[channel][number], value, instrument, queue );
+
+        if (number < 32) {
+            msb_[channel][number] = value;
+            dispatch( controllers_[channel][MidiParameterShaper::Controller14Bit + number], value, instrument, queue );
+        }
+        else if (number < 64) {
+            int msb = msb_[channel][number - 32];
+            dispatch( controllers_[channel][MidiParameterShaper::Controller14Bit + number - 32], msb + value / 128., instrument, queue );
+        }
+
+        int& nrpn = nrpn_[channel];
+        switch (number)
+        {
+        case 99: nrpn = (value << 7) | (nrpn >= 0 ? nrpn & 0x7f : 0); break;    // NRPN MSB
+        case 98: nrpn = (nrpn >= 0 ? nrpn & ~0x7f : 0) | value; break;          // NRPN LSB
+        case 101:
+        case 100: nrpn = -1; break;                                             // RPN deselects the NRPN
+        case 6:                                                                 // data entry MSB
+        case 38:                                                                // data entry LSB
+            if (nrpn >= 0)
+            {
+                std::unordered_map< int, Range >::const_iterator pos = nrpns_.find( (channel << 14) | nrpn );
+                if (pos != nrpns_.end())
+                {
+                    double controllerValue = value;
+                    if (number == 6) dataMsb_[channel] = value;
+                    else controllerValue   = dataMsb_[channel] + value / 128.;
+
+                    dispatch( pos->second, controllerValue, instrument, queue );
+                }
+            }
+            break;
+        }
+    }
+
+
+    void ControllerMap::dispatch( const Range& range, double controllerValue, Instrument* instrument, ParameterQueue* queue )
+    {
+        for (int i = range.first; i < range.first + range.count; i++)
+        {
+            Target& target = targets_[slots_[i]];
+            double value   = target.controller.scaleController( controllerValue, target.range );
+
+            if (target.accepted == false)
+            {
+                if (fabs( value - target.value ) > 2 * target.range.getInterval()) {
+                    continue;
+                }
+                target.accepted = true;
+            }
+            if (value == target.value) continue;    // repeated controller values
+
+            target.change.previousValue_ = target.value;
+            target.change.value_         = value;
+            target.value                 = value;
+            queue->add( instrument, target.change );
+        }
+    }
+
+
+    void ControllerMap::onParameterChange( const ParameterChange& change )
+    {
+        std::unordered_map< int64_t, int >::const_iterator pos = targetIndex_.find( makeKey( change.moduleId_, change.paramId_, change.link_ ) );
+        if (pos != targetIndex_.end())
+        {
+            Target& target  = targets_[pos->second];
+            target.value    = change.value_;
+            target.accepted = target.controller.getSoftTakeover() == false;
+        }
+    }
+
+
+    int64_t ControllerMap::makeKey( int moduleId, int paramId, bool link )
+    {
+        return ((int64_t)moduleId << 32) | ((int64_t)(uint32_t)paramId << 1) | (link ? 1 : 0);
+    }
+
+} // namespace e3
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include "core/Parameter.h"
+#include "core/ParameterQueue.h"
+
+
+namespace e3 {
+
+    class Instrument;
+    class Preset;
+
+    //--------------------------------------------------------------------------
+    // class ControllerMap
+    // Routes MIDI controllers to the parameters that are assigned to them
+    // (see MidiParameterShaper). compile() builds a table indexed by channel
+    // and controller id, so a controller message reaches its targets without
+    // searching. Handles 14-bit controller pairs, NRPN and soft takeover.
+    // Values are handed to the ParameterQueue, which merges repeated values
+    // of the same parameter within a block and smoothes them.
+    //--------------------------------------------------------------------------
+
+    class ControllerMap
+    {
+    public:
+        enum {
+            NumChannels    = 16,
+            NumControllers = MidiParameterShaper::ControllerNrpn    // plain and 14-bit controller ids
+        };
+
+        ControllerMap();
+
+        // Message thread, while processing is suspended.
+        void compile( const Preset& preset );
+        void clear();
+
+        // Message thread. False if the controller assignment of parameter has
+        // changed since compile().
+        bool matches( const Parameter& parameter ) const;
+
+        // Audio thread. channel: 0-15, number and value: 0-127
+        void handleController( int channel, int number, int value, Instrument* instrument, ParameterQueue* queue );
+        void onParameterChange( const ParameterChange& change );
+
+        int getNumTargets() const       { return (int)targets_.size(); }
+
+    protected:
+        struct Target
+        {
+            ParameterChange change;
+            MidiParameterShaper controller;
+            ParameterShaper range;
+            double value;
+            bool accepted;              // soft takeover: false until the controller meets the value
+        };
+
+        struct Range
+        {
+            int first = 0;
+            int count = 0;
+        };
+
+        void addParameters( const ParameterSet& parameters );
+        void dispatch( const Range& range, double controllerValue, Instrument* instrument, ParameterQueue* queue );
+        static int64_t makeKey( int moduleId, int paramId, bool link );
+
+        std::vector< Target > targets_;
+        std::vector< int > slots_;                          // target indices, grouped by channel and controller
+        Range controllers_[NumChannels][NumControllers];
+        std::unordered_map< int, Range > nrpns_;            // key: channel << 14 | nrpn number
+        std::unordered_map< int64_t, int > targetIndex_;    // key: makeKey()
+
+        // running status per channel
+        int msb_[NumChannels][32];
+        int nrpn_[NumChannels];                             // selected NRPN, -1 if none
+        int dataMsb_[NumChannels];
+    };
+
+} // namespace e3
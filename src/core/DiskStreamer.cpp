@@ -0,0 +1,226 @@
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <e3_Exception.h>
+#include <e3_Trace.h>
+#include "core/DiskStreamer.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class SampleFile
+    //--------------------------------------------------------------------------
+
+    std::shared_ptr< SampleFile > SampleFile::load( const std::string& path, int headFrames )
+    {
+        AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();       // WAV, AIFF, FLAC
+
+        File file( path );
+        std::unique_ptr< AudioFormatReader > reader( file.existsAsFile() ? formatManager.createReaderFor( file ) : nullptr );
+        if (reader == nullptr) {
+            TRACE( "SampleFile::load: %s can not be read\n", path.c_str() );
+            return std::shared_ptr< SampleFile >();
+        }
+
+        std::shared_ptr< SampleFile > sample( new SampleFile() );
+        sample->path_          = path;
+        sample->numFrames_     = reader->lengthInSamples;
+        sample->numHeadFrames_ = std::min<int64_t>( sample->numFrames_, std::max<int>( 0, headFrames ) );
+        sample->sampleRate_    = reader->sampleRate > 0 ? reader->sampleRate : 44100;
+
+        int numChannels = std::min<int>( 2, std::max<int>( 1, (int)reader->numChannels ) );
+        sample->head_.setSize( numChannels, std::max<int>( 1, (int)sample->numHeadFrames_ ) );
+        sample->head_.clear();
+        reader->read( &sample->head_, 0, (int)sample->numHeadFrames_, 0, true, numChannels > 1 );
+
+        sample->reader_ = std::move( reader );
+        return sample;
+    }
+
+
+    void SampleFile::read( float* left, float* right, int64_t startFrame, int numFrames )
+    {
+        int numChannels = head_.getNumChannels();
+        readBuffer_.setSize( numChannels, numFrames, false, false, true );
+        reader_->read( &readBuffer_, 0, numFrames, startFrame, true, numChannels > 1 );
+
+        memcpy( left, readBuffer_.getReadPointer( 0 ), numFrames * sizeof( float ) );
+        if (right != left) {
+            memcpy( right, readBuffer_.getReadPointer( numChannels - 1 ), numFrames * sizeof( float ) );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------
+    // class SampleStream
+    //--------------------------------------------------------------------------
+
+    SampleStream::SampleStream() :
+        request_( 0 ),
+        servedId_( 0 ),
+        readFrame_( 0 ),
+        writeFrame_( 0 )
+    {}
+
+
+    int SampleStream::getCapacity( const SampleFile& file )
+    {
+        int64_t numFrames = std::min<int64_t>( MaxCapacity, file.getNumFrames() - file.getNumHeadFrames() );
+        int capacity      = 1;
+        while (capacity < numFrames) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+
+    void SampleStream::setBuffer( float* left, float* right, int capacity )
+    {
+        ASSERT( capacity > 0 && (capacity & (capacity - 1)) == 0 );
+
+        left_     = left;
+        right_    = right;
+        capacity_ = capacity;
+        mask_     = capacity - 1;
+    }
+
+
+    void SampleStream::setFile( const std::shared_ptr< SampleFile >& file )
+    {
+        file_ = file;
+        request_.store( 0 );
+        served_ = 0;
+    }
+
+
+    // The read position goes first, the producer sees it together with the request.
+    void SampleStream::start( int64_t frame )
+    {
+        requestId_ = (requestId_ + 1) & 0xffffff;
+        if (requestId_ == 0) requestId_ = 1;
+
+        readFrame_.store( frame, std::memory_order_relaxed );
+        setRequest( requestId_, frame );
+    }
+
+
+    void SampleStream::setRequest( uint32_t id, int64_t frame )
+    {
+        uint64_t request = (frame < 0) ? 0 : ((uint64_t)id << FrameBits) | (uint64_t)(frame + 1);
+        request_.store( request, std::memory_order_release );
+    }
+
+
+    int64_t SampleStream::getEnd() const
+    {
+        if (servedId_.load( std::memory_order_acquire ) != requestId_) return -1;
+        return writeFrame_.load( std::memory_order_acquire );
+    }
+
+
+    // Writes behind the end only where the consumer has passed already.
+    bool SampleStream::fill()
+    {
+        uint64_t request = request_.load( std::memory_order_acquire );
+        if (request == 0 || file_ == nullptr || capacity_ == 0) return false;
+
+        if (request != served_)
+        {
+            served_ = request;
+            writeFrame_.store( (int64_t)(request & (((uint64_t)1 << FrameBits) - 1)) - 1, std::memory_order_relaxed );
+            servedId_.store( (uint32_t)(request >> FrameBits), std::memory_order_release );
+        }
+
+        int64_t write = writeFrame_.load( std::memory_order_relaxed );
+        int64_t limit = std::min<int64_t>( file_->getNumFrames(), readFrame_.load( std::memory_order_acquire ) + capacity_ );
+        int numFrames = (int)std::min<int64_t>( limit - write, ChunkSize );
+        numFrames     = std::min<int>( numFrames, capacity_ - (int)(write & mask_) );    // up to the wrap
+        if (numFrames <= 0) return false;
+
+        file_->read( left_ + (write & mask_), right_ + (write & mask_), write, numFrames );
+        writeFrame_.store( write + numFrames, std::memory_order_release );
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------
+    // class DiskStreamer
+    //--------------------------------------------------------------------------
+
+    namespace {
+
+        std::mutex streamLock;                  // the streams, held by the thread during a pass
+        std::vector< SampleStream* > streams;
+
+        std::mutex threadLock;                  // message thread only
+        std::thread streamThread;
+        std::atomic< bool > running( false );
+
+        void streamLoop()
+        {
+            while (running.load())
+            {
+                while (DiskStreamer::service() > 0 && running.load());
+                std::this_thread::sleep_for( std::chrono::milliseconds( DiskStreamer::PollInterval ) );
+            }
+        }
+    }
+
+
+    void DiskStreamer::add( SampleStream* stream )
+    {
+        std::lock_guard< std::mutex > lock( threadLock );
+        {
+            std::lock_guard< std::mutex > lock( streamLock );
+            if (std::find( streams.begin(), streams.end(), stream ) != streams.end()) return;
+            streams.push_back( stream );
+        }
+        if (running.load() == false)
+        {
+            running.store( true );
+            streamThread = std::thread( streamLoop );
+        }
+    }
+
+
+    void DiskStreamer::remove( SampleStream* stream )
+    {
+        std::lock_guard< std::mutex > lock( threadLock );
+        bool empty;
+        {
+            std::lock_guard< std::mutex > lock( streamLock );
+            streams.erase( std::remove( streams.begin(), streams.end(), stream ), streams.end() );
+            empty = streams.empty();
+        }
+        if (empty && running.load())
+        {
+            running.store( false );
+            streamThread.join();
+        }
+    }
+
+
+    int DiskStreamer::service()
+    {
+        std::lock_guard< std::mutex > lock( streamLock );
+
+        int numChunks = 0;
+        for (size_t i = 0; i < streams.size(); i++)
+        {
+            if (streams[i]->fill()) numChunks++;
+        }
+        return numChunks;
+    }
+
+
+    int DiskStreamer::getNumStreams()
+    {
+        std::lock_guard< std::mutex > lock( streamLock );
+        return (int)streams.size();
+    }
+
+} // namespace e3
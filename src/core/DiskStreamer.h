@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <atomic>
+#include "JuceHeader.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class SampleFile
+    // An audio file (WAV, AIFF, FLAC) played from disk. The first HeadFrames
+    // frames are loaded into memory, so a note can start at once, the rest is
+    // read on demand by the DiskStreamer thread. Mono files return the same
+    // channel for left and right.
+    //--------------------------------------------------------------------------
+
+    class SampleFile
+    {
+    public:
+        enum { HeadFrames = 32768 };
+
+        // Message thread. Returns nullptr if the file can not be read.
+        static std::shared_ptr< SampleFile > load( const std::string& path, int headFrames = HeadFrames );
+
+        const std::string& getPath() const          { return path_; }
+        int64_t getNumFrames() const                { return numFrames_; }
+        int64_t getNumHeadFrames() const            { return numHeadFrames_; }
+        int getNumChannels() const                  { return head_.getNumChannels(); }
+        double getSampleRate() const                { return sampleRate_; }
+        const float* getHead( int channel ) const   { return head_.getReadPointer( channel < head_.getNumChannels() ? channel : 0 ); }
+
+        // DiskStreamer thread. Reads numFrames from startFrame on into left and right,
+        // which may be the same buffer for a mono file.
+        void read( float* left, float* right, int64_t startFrame, int numFrames );
+
+    protected:
+        SampleFile() {}
+
+        std::string path_;
+        std::unique_ptr< AudioFormatReader > reader_;
+        AudioSampleBuffer head_;
+        AudioSampleBuffer readBuffer_;              // DiskStreamer thread, one chunk
+        int64_t numFrames_     = 0;
+        int64_t numHeadFrames_ = 0;
+        double sampleRate_     = 44100;
+    };
+
+
+    //--------------------------------------------------------------------------
+    // class SampleStream
+    // Ring buffer of the frames behind the head of a SampleFile, for one voice.
+    // The audio thread is the only consumer, the DiskStreamer thread the only
+    // producer. Frames are addressed by their position in the file: the ring
+    // holds the frames up to getEnd(), the consumer publishes the first frame
+    // it still needs, and the producer never overwrites it.
+    // start() asks for a new position, the frames of the previous request are
+    // invalid from then on, until the producer has served the new one.
+    // The ring is owned by the caller, see Sampler::initData().
+    //--------------------------------------------------------------------------
+
+    class SampleStream
+    {
+    public:
+        enum {
+            MaxCapacity = 16384,    // frames
+            ChunkSize   = 2048      // frames read at once
+        };
+
+        SampleStream();
+
+        // The ring size for file: the frames behind the head, rounded up to a power
+        // of two and at most MaxCapacity.
+        static int getCapacity( const SampleFile& file );
+
+        // Message thread, while the stream is not added to the DiskStreamer.
+        // left and right hold capacity frames each, capacity is a power of two.
+        // A mono file may use left for both.
+        void setBuffer( float* left, float* right, int capacity );
+        void setFile( const std::shared_ptr< SampleFile >& file );
+        int getCapacity() const                     { return capacity_; }
+
+        // Audio thread
+        void start( int64_t frame );
+        void stop()                                 { setRequest( 0, -1 ); }
+        void setReadPosition( int64_t frame )       { readFrame_.store( frame, std::memory_order_release ); }
+        int64_t getEnd() const;                     // frames before are available, -1 if none are
+
+        float getLeft( int64_t frame ) const        { return left_[frame & mask_]; }
+        float getRight( int64_t frame ) const       { return right_[frame & mask_]; }
+
+        // DiskStreamer thread. Returns true if frames were read.
+        bool fill();
+
+    protected:
+        enum { FrameBits = 40 };
+
+        void setRequest( uint32_t id, int64_t frame );
+
+        std::shared_ptr< SampleFile > file_;
+        float* left_   = nullptr;
+        float* right_  = nullptr;
+        int capacity_  = 0;
+        int64_t mask_  = 0;
+
+        uint32_t requestId_ = 0;                    // audio thread only
+        std::atomic< uint64_t > request_;           // request id << FrameBits | start frame + 1, 0: stopped
+        std::atomic< uint32_t > servedId_;
+        std::atomic< int64_t > readFrame_;
+        std::atomic< int64_t > writeFrame_;
+        uint64_t served_ = 0;                       // producer only
+    };
+
+
+    //--------------------------------------------------------------------------
+    // class DiskStreamer
+    // Background thread that keeps the SampleStreams filled. It wakes up every
+    // PollInterval msec and reads a chunk for each stream that has room, until
+    // no stream needs more. The audio thread never waits for it: frames that
+    // have not arrived in time are missing from the output. Streams are added
+    // and removed by the message thread, the first added stream starts the
+    // thread and removing the last one stops it.
+    //--------------------------------------------------------------------------
+
+    class DiskStreamer
+    {
+    public:
+        enum { PollInterval = 2 };      // msec
+
+        // Message thread. remove() waits until the thread has left the stream.
+        static void add( SampleStream* stream );
+        static void remove( SampleStream* stream );
+
+        // One pass over all streams, returns the number of chunks read.
+        static int service();
+        static int getNumStreams();
+    };
+
+} // namespace e3
@@ -14,7 +14,7 @@
 #define INITIAL_SAMPLERATE 44100
 #define INITIAL_CONTROLRATE 400
 #define NUMPROGRAMS 128
-#define NUMINPUTS 0
+#define NUMINPUTS 4           // main and sidechain, see AudioInTerminal
 #define NUMOUTPUTS 2
 
 
@@ -0,0 +1,298 @@
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <e3_Exception.h>
+#include "core/Instrument.h"
+#include "core/Module.h"
+#include "core/Preset.h"
+#include "core/HostParameters.h"
+
+
+namespace e3 {
+
+    HostParameters::HostParameters() :
+        slots_( MaxParameters ),
+        values_( new std::atomic< float >[MaxParameters] ),
+        changed_( new std::atomic< bool >[MaxParameters] ),
+        hasChanged_( false ),
+        numParameters_( 0 )
+    {
+        for (int i = 0; i < MaxParameters; i++) {
+            values_[i].store( 0 );
+            changed_[i].store( false );
+        }
+    }
+
+
+    void HostParameters::clear()
+    {
+        std::lock_guard< std::mutex > lock( slotLock_ );
+
+        for (int i = 0; i < getNumParameters(); i++) {
+            slots_[i] = Slot();
+            values_[i].store( 0 );
+            changed_[i].store( false );
+        }
+        numParameters_.store( 0 );
+        hasChanged_.store( false );
+        slotIndex_.clear();
+        ring_.clear();
+        numChanges_ = 0;
+        nextChange_ = 0;
+    }
+
+
+    void HostParameters::update( const Instrument* instrument )
+    {
+        ASSERT( instrument );
+        const Preset& preset = instrument->getCurrentPreset();
+
+        std::vector< const Parameter* > parameters;
+        const ParameterSet* sets[] = { &preset.getModuleParameters(), &preset.getLinkParameters() };
+        for (int i = 0; i < 2; i++)
+        {
+            for (ParameterSet::const_iterator it = sets[i]->begin(); it != sets[i]->end(); ++it) {
+                parameters.push_back( &(*it) );
+            }
+        }
+        std::lock_guard< std::mutex > lock( slotLock_ );
+        int numParameters = getNumParameters();
+
+        // parameters that are gone free their index
+        std::vector< bool > used( numParameters, false );
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            int index = getIndex( parameters[i]->getModuleId(), parameters[i]->getId(), parameters[i]->isLinkType() );
+            if (index >= 0) used[index] = true;
+        }
+        for (int i = 0; i < numParameters; i++)
+        {
+            if (used[i] == false && slots_[i].change.moduleId_ >= 0) {
+                const ParameterChange& change = slots_[i].change;
+                slotIndex_.erase( makeKey( change.moduleId_, change.paramId_, change.link_ ) );
+                slots_[i] = Slot();
+                values_[i].store( 0 );
+                changed_[i].store( false );
+            }
+        }
+
+        // new parameters take the first free index
+        int freeIndex = 0;
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            const Parameter& parameter = *parameters[i];
+            int64_t key = makeKey( parameter.getModuleId(), parameter.getId(), parameter.isLinkType() );
+            if (slotIndex_.find( key ) != slotIndex_.end()) continue;
+
+            while (freeIndex < numParameters && slots_[freeIndex].change.moduleId_ >= 0) freeIndex++;
+            if (freeIndex == MaxParameters) break;
+            if (freeIndex == numParameters) numParameters++;
+
+            slots_[freeIndex].change = ParameterChange( parameter, parameter.value_ );
+            slotIndex_[key] = freeIndex;
+        }
+        while (numParameters > 0 && slots_[numParameters - 1].change.moduleId_ < 0) {
+            numParameters--;
+        }
+
+        // labels, ranges and values may have changed for all of them
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            const Parameter& parameter = *parameters[i];
+            int index = getIndex( parameter.getModuleId(), parameter.getId(), parameter.isLinkType() );
+            if (index < 0) continue;        // beyond MaxParameters
+
+            Slot& slot   = slots_[index];
+            slot.change  = ParameterChange( parameter, parameter.value_ );
+            slot.range   = parameter.valueShaper_;
+            slot.unit    = parameter.unit_;
+            slot.numberFormat = parameter.numberFormat_;
+
+            Module* module    = instrument->getModule( parameter.getModuleId() );
+            std::string label = module != nullptr ? module->getLabel() : "Module " + std::to_string( parameter.getModuleId() );
+            slot.name = parameter.isLinkType() ?
+                label + " Link " + std::to_string( parameter.getId() ) :
+                label + " " + parameter.label_;
+
+            values_[index].store( (float)normalize( index, parameter.value_ ) );
+            changed_[index].store( false );
+        }
+        numParameters_.store( numParameters );
+
+        ring_.clear();          // pending changes refer to the old indices
+        numChanges_ = 0;
+        nextChange_ = 0;
+    }
+
+
+    float HostParameters::getValue( int index ) const
+    {
+        if (index < 0 || index >= getNumParameters()) return 0;
+        return values_[index].load( std::memory_order_relaxed );
+    }
+
+
+    std::string HostParameters::getName( int index ) const
+    {
+        if (index < 0 || index >= getNumParameters()) return std::string();
+
+        std::lock_guard< std::mutex > lock( slotLock_ );
+        return slots_[index].name;
+    }
+
+
+    std::string HostParameters::getText( int index ) const
+    {
+        if (index < 0 || index >= getNumParameters()) return std::string();
+
+        std::lock_guard< std::mutex > lock( slotLock_ );
+        const Slot& slot = slots_[index];
+        if (slot.change.moduleId_ < 0) return std::string();
+
+        double value     = denormalize( index, getValue( index ) );
+
+        std::ostringstream text;
+        switch (slot.numberFormat)
+        {
+        case NumberInt:
+            text << (int)floor( value + 0.5 );
+            break;
+        case NumberDecibel:
+            if (value <= 0) text << "-inf";
+            else            text << std::fixed << std::setprecision( 1 ) << 20 * log10( value );
+            return text.str() + " dB";
+        default:
+            text << std::fixed << std::setprecision( 2 ) << value;
+            break;
+        }
+        if (slot.unit.empty() == false) {
+            text << " " << slot.unit;
+        }
+        return text.str();
+    }
+
+
+    // An unused index is filtered by collect(), which runs on the audio thread
+    // and therefore never at the same time as update().
+    //
+    bool HostParameters::setValue( int index, float value, int sampleOffset )
+    {
+        if (index < 0 || index >= getNumParameters()) return false;
+
+        HostChange change;
+        change.index        = index;
+        change.sampleOffset = sampleOffset;
+        change.value        = std::max<float>( 0, std::min<float>( 1, value ) );
+        change.previous     = values_[index].exchange( change.value );
+
+        changed_[index].store( true );
+        hasChanged_.store( true );
+        return ring_.push( change );
+    }
+
+
+    int HostParameters::onParameterChange( const ParameterChange& change )
+    {
+        int index = getIndex( change.moduleId_, change.paramId_, change.link_ );
+        if (index >= 0) {
+            values_[index].store( (float)normalize( index, change.value_ ) );
+        }
+        return index;
+    }
+
+
+    int HostParameters::storeValues( const Instrument* instrument )
+    {
+        ASSERT( instrument );
+        if (hasChanged_.exchange( false ) == false) return 0;
+
+        const Preset& preset = instrument->getCurrentPreset();
+        int numStored        = 0;
+
+        for (int i = 0; i < getNumParameters(); i++)
+        {
+            if (changed_[i].exchange( false ) == false) continue;
+
+            const ParameterChange& change = slots_[i].change;
+            ParameterSet& parameters      = change.link_ ? preset.getLinkParameters() : preset.getModuleParameters();
+            ParameterSet::iterator pos    = parameters.find( Parameter( change.paramId_, change.moduleId_ ) );
+            if (pos != parameters.end())
+            {
+                pos->value_ = denormalize( i, getValue( i ) );
+                numStored++;
+            }
+        }
+        return numStored;
+    }
+
+
+    int HostParameters::collect( int numSamples )
+    {
+        numChanges_ = 0;
+        nextChange_ = 0;
+
+        HostChange change;
+        while (numChanges_ < MaxChanges && ring_.pop( change ))
+        {
+            if (change.index >= getNumParameters() || slots_[change.index].change.moduleId_ < 0) continue;
+            change.sampleOffset = std::max<int>( 0, std::min<int>( numSamples - 1, change.sampleOffset ) );
+
+            int i = numChanges_++;      // insertion sort, the host sends them in order mostly
+            while (i > 0 && changes_[i - 1].sampleOffset > change.sampleOffset) {
+                changes_[i] = changes_[i - 1];
+                i--;
+            }
+            changes_[i] = change;
+        }
+        return numChanges_;
+    }
+
+
+    bool HostParameters::getNextChange( ParameterChange& change, int& sampleOffset )
+    {
+        if (nextChange_ >= numChanges_) return false;
+
+        const HostChange& hostChange = changes_[nextChange_++];
+        change                = slots_[hostChange.index].change;
+        change.previousValue_ = denormalize( hostChange.index, hostChange.previous );
+        change.value_         = denormalize( hostChange.index, hostChange.value );
+        sampleOffset          = hostChange.sampleOffset;
+        return true;
+    }
+
+
+    int HostParameters::getIndex( int moduleId, int paramId, bool link ) const
+    {
+        std::unordered_map< int64_t, int >::const_iterator pos = slotIndex_.find( makeKey( moduleId, paramId, link ) );
+        return pos != slotIndex_.end() ? pos->second : -1;
+    }
+
+
+    double HostParameters::normalize( int index, double value ) const
+    {
+        const ParameterShaper& range = slots_[index].range;
+        double v = (range.getRange() != 0) ? (value - range.getMin()) / range.getRange() : 0;
+        return std::max<double>( 0, std::min<double>( 1, v ) );
+    }
+
+
+    // Same quantization as MidiParameterShaper::scaleController()
+    double HostParameters::denormalize( int index, double value ) const
+    {
+        const ParameterShaper& range = slots_[index].range;
+        double v = range.getMin() + value * range.getRange();
+        double interval = range.getInterval();
+        if (range.getNumSteps() > 0 && interval > 0) {
+            v = range.getMin() + floor( (v - range.getMin()) / interval + 0.5 ) * interval;
+        }
+        return v;
+    }
+
+
+    int64_t HostParameters::makeKey( int moduleId, int paramId, bool link )
+    {
+        return ((int64_t)moduleId << 32) | ((int64_t)(uint32_t)paramId << 1) | (link ? 1 : 0);
+    }
+
+} // namespace e3
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include "core/Parameter.h"
+#include "core/ParameterQueue.h"
+#include "core/LockFreeRing.h"
+
+
+namespace e3 {
+
+    class Instrument;
+
+    //--------------------------------------------------------------------------
+    // class HostParameters
+    // Exposes the module and link parameters of the current preset to the host
+    // as an indexed list of automatable parameters with normalized values.
+    // A parameter keeps its index while modules and links are added or removed,
+    // the index of a deleted parameter stays unused until a new parameter takes
+    // it. The host may set values from any thread, the changes travel through
+    // a lock-free ring to the audio thread, which applies them at their sample
+    // offset in the block, and are written back into the preset on the
+    // message thread. The slots are allocated once for MaxParameters, so
+    // update() only rewrites their contents while the host reads them.
+    //--------------------------------------------------------------------------
+
+    class HostParameters
+    {
+    public:
+        enum {
+            Capacity      = 1024,   // must be a power of two
+            MaxChanges    = 256,    // changes applied per block, more wait for the next block
+            MaxParameters = 2048    // more parameters are not exposed to the host
+        };
+
+        HostParameters();
+
+        // Message thread, while processing is suspended.
+        // update() assigns indices to new parameters and keeps the indices of
+        // known ones, clear() forgets all indices, e.g. for another instrument.
+        void update( const Instrument* instrument );
+        void clear();
+
+        // Any thread. Values are normalized to 0..1.
+        int getNumParameters() const                { return numParameters_.load(); }
+        float getValue( int index ) const;
+        std::string getName( int index ) const;
+        std::string getText( int index ) const;
+        bool setValue( int index, float value, int sampleOffset = 0 );
+
+        // Message thread. Tells the list about a value changed by the editor,
+        // returns the index of the parameter or -1 if it is not in the list.
+        int onParameterChange( const ParameterChange& change );
+
+        // Message thread. Writes the values set by the host into the current
+        // preset of the instrument, so they are saved with it. Returns the
+        // number of parameters written.
+        int storeValues( const Instrument* instrument );
+
+        // Audio thread. collect() takes the pending changes for a block of numSamples
+        // and sorts them by offset, getNextChange() returns them one by one.
+        int collect( int numSamples );
+        bool getNextChange( ParameterChange& change, int& sampleOffset );
+
+        int getIndex( int moduleId, int paramId, bool link ) const;
+        int getNumDropped() const                   { return ring_.getNumDropped(); }
+
+        double normalize( int index, double value ) const;
+        double denormalize( int index, double value ) const;
+
+    protected:
+        struct Slot
+        {
+            ParameterChange change;     // moduleId_ -1: unused
+            ParameterShaper range;
+            NumberFormat numberFormat = NumberFloat;
+            std::string name;
+            std::string unit;
+        };
+
+        struct HostChange
+        {
+            int index        = -1;
+            int sampleOffset = 0;
+            float previous   = 0;
+            float value      = 0;
+        };
+
+        static int64_t makeKey( int moduleId, int paramId, bool link );
+
+        std::vector< Slot > slots_;                             // MaxParameters
+        std::unique_ptr< std::atomic< float >[] > values_;     // normalized, one per slot
+        std::unique_ptr< std::atomic< bool >[] > changed_;     // set by the host, see storeValues()
+        std::atomic< bool > hasChanged_;
+        std::atomic< int > numParameters_;
+        std::unordered_map< int64_t, int > slotIndex_;          // key: makeKey(), message thread only
+        mutable std::mutex slotLock_;                           // names, units and formats of the slots
+
+        LockFreeRing< HostChange, Capacity > ring_;
+        HostChange changes_[MaxChanges];
+        int numChanges_ = 0;
+        int nextChange_ = 0;
+    };
+
+} // namespace e3
@@ -1,5 +1,7 @@
 
 
+#include <unordered_set>
+
 #include "core/Polyphony.h"
 #include "core/Settings.h"
 #include "modules/ModuleFactory.h"
@@ -52,16 +54,22 @@ namespace e3 {
         }
         modules_.clear();
         links_.clear();
+        moduleIndex_.clear();
+        inboundLinks_.clear();
+        outboundLinks_.clear();
         presetSet_.clearCurrentPreset();
         InstrumentSerializer::clearModuleComponent( this );
     }
 
 
-    Module* Instrument::createAndAddModule( ModuleType type )
+    Module* Instrument::createAndAddModule( ModuleType type, int id )
     {
         Module* module = ModuleFactory::create( type );
+        module->id_    = (id < 0) ? createUniqueId( type ) : id;
+        ASSERT( getModule( module->id_ ) == nullptr );
+
         modules_.push_back( module );
-        module->id_ = createUniqueId( type );
+        moduleIndex_[module->id_] = module;
 
         return module;
     }
@@ -84,6 +92,9 @@ namespace e3 {
 
             modules_.erase( std::remove( modules_.begin(), modules_.end(), module ), modules_.end() );
             ASSERT( std::find( modules_.begin(), modules_.end(), module ) == modules_.end() );
+            moduleIndex_.erase( module->getId() );
+            inboundLinks_.erase( module->getId() );
+            outboundLinks_.erase( module->getId() );
             delete module;
         }
     }
@@ -181,12 +192,33 @@ namespace e3 {
     }
 
 
-    void Instrument::initModules( double sampleRate, int numVoices, Polyphony* polyphony )
+    // All per voice state is allocated from the arena. Modules in order are initialized
+    // first, so their state is laid out in processing order. A shared arena is not
+    // reset, the caller lays out several instruments behind each other.
+    //
+    void Instrument::initModules( double sampleRate, int numVoices, Polyphony* polyphony, const ModuleList* order, Arena* arena )
     {
+        if (arena == nullptr) {
+            arena = &arena_;
+            arena_.reset();
+        }
+        std::unordered_set< Module* > initialized;
+
+        if (order != nullptr)
+        {
+            for (ModuleList::const_iterator it = order->begin(); it != order->end(); it++)
+            {
+                Module* m = *it;
+                m->init( sampleRate, numVoices, polyphony, arena );
+                initialized.insert( m );
+            }
+        }
         for (ModuleList::iterator it = modules_.begin(); it != modules_.end(); it++)
         {
             Module* m = *it;
-            m->init( sampleRate, numVoices, polyphony );
+            if (initialized.find( m ) == initialized.end()) {
+                m->init( sampleRate, numVoices, polyphony, arena );
+            }
         }
     }
 
@@ -262,19 +294,16 @@ namespace e3 {
 
     Module* Instrument::getModule( int moduleId ) const
     {
-        for (ModuleList::const_iterator it = modules_.begin(); it != modules_.end(); it++)
-        {
-            if ((*it)->id_ == moduleId) {
-                return *it;
-            }
-        }
-        return nullptr;
+        ModuleIndex::const_iterator pos = moduleIndex_.find( moduleId );
+        return (pos != moduleIndex_.end()) ? pos->second : nullptr;
     }
 
 
     void Instrument::addLink( Link& link, bool addParameter )
     {
         links_.add( link );
+        outboundLinks_[link.leftModule_].push_back( link );
+        inboundLinks_[link.rightModule_].push_back( link );
 
         if (addParameter) {
             const Parameter& p = getCurrentPreset().getLinkParameters().addLinkParameter( link.getId(), link.leftModule_ );
@@ -285,29 +314,67 @@ namespace e3 {
 
     void Instrument::removeLink( const Link& link )
     {
-        removeLinkParameters( link.getId(), link.leftModule_ );
-        links_.remove( link );
+        Link removed = link;     // link may reference an element of one of the containers below
+        removeLinkParameters( removed.getId(), removed.leftModule_ );
+        links_.remove( removed );
+
+        removeFromLinkIndex( outboundLinks_, removed.leftModule_, removed );
+        removeFromLinkIndex( inboundLinks_, removed.rightModule_, removed );
     }
 
 
+    void Instrument::removeFromLinkIndex( LinkIndex& index, int moduleId, const Link& link )
+    {
+        LinkIndex::iterator pos = index.find( moduleId );
+        if (pos != index.end())
+        {
+            LinkList& list = pos->second;
+            list.erase( std::remove( list.begin(), list.end(), link ), list.end() );
+            if (list.empty()) {
+                index.erase( pos );
+            }
+        }
+    }
+
 
     void Instrument::getLinksForModule( int moduleId, PortType portType, LinkList& list )
     {
         list.clear();
 
-        for (LinkSet::iterator it = links_.begin(); it != links_.end(); ++it)
+        if (portType == PortTypeInport || portType == PortTypeUndefined)
         {
-            const Link& link = *it;
-            if ((portType == PortTypeInport || portType == PortTypeUndefined) && link.rightModule_ == moduleId) {
-                list.push_back( link );
-            }
-            else if ((portType == PortTypeOutport || portType == PortTypeUndefined) && link.leftModule_ == moduleId) {
-                list.push_back( link );
+            const LinkList& inbound = getInboundLinks( moduleId );
+            list.insert( list.end(), inbound.begin(), inbound.end() );
+        }
+        if (portType == PortTypeOutport || portType == PortTypeUndefined)
+        {
+            const LinkList& outbound = getOutboundLinks( moduleId );
+            for (LinkList::const_iterator it = outbound.begin(); it != outbound.end(); ++it) 
+            {
+                if (portType == PortTypeOutport || it->isSameModule() == false) {   // self links are already listed as inbound
+                    list.push_back( *it );
+                }
             }
         }
     }
 
 
+    const LinkList& Instrument::getInboundLinks( int moduleId ) const
+    {
+        static const LinkList empty;
+        LinkIndex::const_iterator pos = inboundLinks_.find( moduleId );
+        return (pos != inboundLinks_.end()) ? pos->second : empty;
+    }
+
+
+    const LinkList& Instrument::getOutboundLinks( int moduleId ) const
+    {
+        static const LinkList empty;
+        LinkIndex::const_iterator pos = outboundLinks_.find( moduleId );
+        return (pos != outboundLinks_.end()) ? pos->second : empty;
+    }
+
+
     void Instrument::removeModuleParameters( int moduleId )
     {
         getCurrentPreset().getModuleParameters().removeAllByModule( moduleId );
@@ -336,7 +403,7 @@ namespace e3 {
         }
 
         int minId = ModuleTypeAudioOutTerminal + 1;
-        int maxId = modules_.size();
+        int maxId = modules_.size() + 1;
         int id    = minId;
 
         for (; id <= maxId; id++) {
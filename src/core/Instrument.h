@@ -3,8 +3,10 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include "JuceHeader.h"
 #include "core/Preset.h"
+#include "core/Arena.h"
 #include "core/Module.h"
 
 
@@ -12,6 +14,9 @@ namespace e3 {
 
     class Polyphony;
 
+    typedef std::unordered_map< int, Module* > ModuleIndex;     // moduleId -> Module
+    typedef std::unordered_map< int, LinkList > LinkIndex;      // moduleId -> Links
+
     class Instrument
     {
     public:
@@ -23,7 +28,7 @@ namespace e3 {
 
 
         void deleteModules();
-        void initModules( double sampleRate, int numVoices, Polyphony* polyphony = nullptr );
+        void initModules( double sampleRate, int numVoices, Polyphony* polyphony = nullptr, const ModuleList* order = nullptr, Arena* arena = nullptr );
         void resetModules();
         void connectModules();
         void updateModules();
@@ -42,13 +47,16 @@ namespace e3 {
         const ModuleList& getModules() const    { return modules_; }
         int getNumModules() const               { return modules_.size(); }
 
-        Module* createAndAddModule( ModuleType type );
+        Module* createAndAddModule( ModuleType type, int id = -1 );
         void deleteModule( Module* module );
 
         void addLink( Link& link, bool addParameter = true );
         void removeLink( const Link& link );
         LinkSet& getLinks()                        { return links_; }
+        const LinkSet& getLinks() const            { return links_; }
         void getLinksForModule( int moduleId, PortType portType, LinkList& list );
+        const LinkList& getInboundLinks( int moduleId ) const;
+        const LinkList& getOutboundLinks( int moduleId ) const;
 
         void setNumVoices( int numVoices )         { numVoices_    = numVoices; }
         void setNumUnison( int numUnison )         { numUnison_    = numUnison; }
@@ -56,13 +64,15 @@ namespace e3 {
         void setHold( bool hold )                  { hold_         = hold; }
         void setRetrigger( bool retrigger )        { retrigger_    = retrigger; }
         void setLegato( bool legato )              { legato_       = legato; }
+        void setMpe( bool mpe )                    { mpe_          = mpe; }
+        void setStealPolicy( int policy )          { stealPolicy_  = policy; }
 
         void setFilePath( const std::string& path ) { file_ = path; }
         File getFilePath() const                    { return file_; }
         void storeFilePath() const;
 
         void setXml( XmlElement* xml )    { xml_ = xml; }
-        XmlElement* getXml()              { return xml_; }
+        XmlElement* getXml() const        { return xml_; }
 
 
         int presetId_     = 0;
@@ -72,6 +82,8 @@ namespace e3 {
         bool hold_        = false;
         bool retrigger_   = false;
         bool legato_      = false;
+        bool mpe_         = false;
+        int stealPolicy_  = 0;          // Polyphony::StealPolicy
         bool ready_       = false;
 
         std::string name_ = "Default";
@@ -84,10 +96,15 @@ namespace e3 {
         std::string createParameterLabel( const Link& link );
         void removeModuleParameters( int moduleId );
         void removeLinkParameters( int linkId, int moduleId );
+        void removeFromLinkIndex( LinkIndex& index, int moduleId, const Link& link );
 
 
         ModuleList modules_;
         LinkSet links_;
+        ModuleIndex moduleIndex_;
+        LinkIndex inboundLinks_;
+        LinkIndex outboundLinks_;
+        Arena arena_;
         PresetSet presetSet_;
         Preset currentPreset_;
 
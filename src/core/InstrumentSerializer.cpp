@@ -122,6 +122,8 @@ namespace e3 {
         instrument->hold_         = e->getBoolAttribute( "hold", instrument->hold_ );
         instrument->retrigger_    = e->getBoolAttribute( "retrigger", instrument->retrigger_ );
         instrument->legato_       = e->getBoolAttribute( "legato", instrument->legato_ );
+        instrument->mpe_          = e->getBoolAttribute( "mpe", instrument->mpe_ );
+        instrument->stealPolicy_  = e->getIntAttribute( "stealPolicy", instrument->stealPolicy_ );
         instrument->numVoices_    = (uint16_t)e->getIntAttribute( "voices", instrument->numVoices_ );
         instrument->numUnison_    = (uint16_t)e->getIntAttribute( "unison", instrument->numUnison_ );
         instrument->unisonSpread_ = (uint16_t)e->getIntAttribute( "spread", instrument->unisonSpread_ );
@@ -135,12 +137,13 @@ namespace e3 {
         forEachXmlChildElementWithTagName( *modules, e, "module" )
         {
             ModuleType type = (ModuleType)e->getIntAttribute( "type" );
-            Module* module = instrument->createAndAddModule( type );
+            Module* module = instrument->createAndAddModule( type, e->getIntAttribute( "id" ) );
 
             try {
-                module->setId( e->getIntAttribute( "id" ) );
                 module->setLabel( e->getStringAttribute( "label", module->getLabel()).toStdString() );
-                module->setVoicingType( (VoicingType)e->getIntAttribute( "voicing", module->getVoicingType() ) );
+                int voicing = e->getIntAttribute( "voicing", module->getVoicingType() );     // older files
+                module->setVoicingType( (VoicingType)e->getIntAttribute( "poly", voicing ) );
+                module->setResource( e->getStringAttribute( "resource" ).toStdString() );
             }
             catch (...) {
                 TRACE( "module of type %d could not be created", type );
@@ -171,6 +174,7 @@ namespace e3 {
     {
         XmlElement* presetsXml = getChildElement( parent, "presets" );
         PresetSet& presetSet   = const_cast<PresetSet&>(instrument->getPresets());
+        int format             = presetsXml->getIntAttribute( "format", 0 );
 
         forEachXmlChildElementWithTagName( *presetsXml, presetXml, "preset" )
         {
@@ -194,7 +198,7 @@ namespace e3 {
                     if (module) 
                     {
                         const Parameter& param = module->getDefaultParameter( paramId );
-                        readParameter( paramXml, param );
+                        readParameter( paramXml, param, format );
                         moduleParameters.add( param );
                     }
                 }
@@ -205,7 +209,7 @@ namespace e3 {
                     moduleId               = link.leftModule_;
                     const Parameter& param = linkParameters.addLinkParameter( linkId, moduleId );
                     
-                    readParameter( paramXml, param );
+                    readParameter( paramXml, param, format );
                 }
             }
         }
@@ -213,12 +217,17 @@ namespace e3 {
     }
 
 
-    void InstrumentSerializer::readParameter( XmlElement* e, const Parameter& p )
+    // Presets of an older format keep their sound: velocity sensitivity and key
+    // tracking, which were ignored then, are not read.
+    //
+    void InstrumentSerializer::readParameter( XmlElement* e, const Parameter& p, int format )
     {
         p.value_        = e->getDoubleAttribute( "value", p.value_ );
         p.defaultValue_ = e->getDoubleAttribute( "default", p.defaultValue_ );
-        p.veloSens_     = e->getDoubleAttribute( "vsens", p.veloSens_ );
-        p.keyTrack_     = e->getDoubleAttribute( "ktrack", p.keyTrack_ );
+        if (format >= FormatModulation) {
+            p.veloSens_ = e->getDoubleAttribute( "vsens", p.veloSens_ );
+            p.keyTrack_ = e->getDoubleAttribute( "ktrack", p.keyTrack_ );
+        }
         p.resolution_   = e->getDoubleAttribute( "res", p.resolution_ );
         p.label_        = e->getStringAttribute( "label", p.label_ ).toStdString();
         p.unit_         = e->getStringAttribute( "unit", p.unit_ ).toStdString();
@@ -230,6 +239,7 @@ namespace e3 {
         p.valueShaper_.setFactor( (int16_t)e->getIntAttribute( "factor", p.valueShaper_.getFactor() ) );
 
         p.midiShaper_.setControllerId( (int16_t)e->getIntAttribute( "cc", p.midiShaper_.getControllerId() ) );
+        p.midiShaper_.setControllerChannel( (int16_t)e->getIntAttribute( "ccchannel", p.midiShaper_.getControllerChannel() ) );
         p.midiShaper_.setControllerMin( e->getDoubleAttribute( "ccmin", p.midiShaper_.getControllerMin() ) );
         p.midiShaper_.setControllerMax( e->getDoubleAttribute( "ccmax", p.midiShaper_.getControllerMax() ) );
         p.midiShaper_.setSoftTakeover( e->getBoolAttribute( "ccsoft", p.midiShaper_.getSoftTakeover() ) );
@@ -258,6 +268,10 @@ namespace e3 {
             e->setAttribute( "retrigger", instrument->retrigger_ );
         if (instrument->legato_)
             e->setAttribute( "legato", instrument->legato_ );
+        if (instrument->mpe_)
+            e->setAttribute( "mpe", instrument->mpe_ );
+        if (instrument->stealPolicy_ != 0)
+            e->setAttribute( "stealPolicy", instrument->stealPolicy_ );
     }
 
 
@@ -293,6 +307,7 @@ namespace e3 {
 
         const PresetSet& presetSet = instrument->getPresets();
         presetsXml->setAttribute( "selected", presetSet.getCurrentPresetId() );
+        presetsXml->setAttribute( "format", FormatModulation );
 
         for (PresetSet::const_iterator it = presetSet.begin(); it != presetSet.end(); ++it)
         {
@@ -308,6 +323,9 @@ namespace e3 {
         e->setAttribute( "label", module->getLabel() );
         e->setAttribute( "type", module->moduleType_ );
         e->setAttribute( "poly", module->getVoicingType() );
+        if (module->getResource().empty() == false) {
+            e->setAttribute( "resource", String( module->getResource() ) );
+        }
     }
 
 
@@ -395,6 +413,8 @@ namespace e3 {
         const MidiParameterShaper& defaultMidiValue = defaultParam.midiShaper_;
         if (midiValue.getControllerId() != defaultMidiValue.getControllerId())
             e->setAttribute( "cc", midiValue.getControllerId() );
+        if (midiValue.getControllerChannel() != defaultMidiValue.getControllerChannel())
+            e->setAttribute( "ccchannel", midiValue.getControllerChannel() );
         if (midiValue.getControllerMin() != defaultMidiValue.getControllerMin())
             e->setAttribute( "ccmin", midiValue.getControllerMin() );
         if (midiValue.getControllerMax() != defaultMidiValue.getControllerMax())
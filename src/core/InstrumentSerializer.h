@@ -34,12 +34,16 @@ namespace e3 {
 		static void clearModuleComponent( Instrument* instrument, int moduleId = -1 );
 
 
+        // Format of the presets element. Before FormatModulation, velocity sensitivity
+        // and key tracking were stored but had no effect.
+        enum { FormatModulation = 1 };
+
     protected:
         static void readAttributes( XmlElement* e, Instrument* instrument );
         static void readModules( XmlElement* e, Instrument* instrument );
         static void readLinks( XmlElement* e, Instrument* instrument );
         static void readPresets( XmlElement* e, Instrument* instrument );
-        static void readParameter( XmlElement* e, const Parameter& p );
+        static void readParameter( XmlElement* e, const Parameter& p, int format = FormatModulation );
 
         static void writeAttributes( XmlElement* e, Instrument* instrument );
         static void writeModules( XmlElement* e, Instrument* instrument );
@@ -0,0 +1,505 @@
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "JuceHeader.h"
+#include <e3_Exception.h>
+#include "core/Instrument.h"
+#include "core/Module.h"
+#include "core/InstrumentState.h"
+
+
+namespace e3 {
+
+    namespace {
+
+        class StateWriter
+        {
+        public:
+            StateWriter( std::vector< char >& data ) : data_( data ) {}
+
+            template< class T > void put( T value )
+            {
+                const char* bytes = reinterpret_cast< const char* >( &value );
+                data_.insert( data_.end(), bytes, bytes + sizeof( T ) );
+            }
+
+            void putString( const std::string& s )
+            {
+                put< uint32_t >( (uint32_t)s.size() );
+                data_.insert( data_.end(), s.begin(), s.end() );
+            }
+
+        private:
+            std::vector< char >& data_;
+        };
+
+
+        class StateReader
+        {
+        public:
+            StateReader( const void* data, size_t size ) :
+                data_( static_cast< const char* >( data ) ),
+                size_( data != nullptr ? size : 0 )
+            {}
+
+            template< class T > T get()
+            {
+                T value;
+                std::memcpy( &value, claim( sizeof( T ) ), sizeof( T ) );
+                return value;
+            }
+
+            std::string getString()
+            {
+                uint32_t length = get< uint32_t >();
+                const char* s   = claim( length );
+                return std::string( s, s + length );
+            }
+
+            // Reads a record count and checks that the data left can hold that many records
+            // of at least minRecordSize bytes, before anyone allocates room for them.
+            uint32_t getCount( size_t minRecordSize )
+            {
+                uint32_t count = get< uint32_t >();
+                if (count > (size_ - position_) / minRecordSize) {
+                    THROW( std::runtime_error, "Instrument state is truncated" );
+                }
+                return count;
+            }
+
+        private:
+            const char* claim( size_t numBytes )
+            {
+                if (numBytes > size_ - position_) {
+                    THROW( std::runtime_error, "Instrument state is truncated" );
+                }
+                const char* p = data_ + position_;
+                position_    += numBytes;
+                return p;
+            }
+
+            const char* data_;
+            size_t size_;
+            size_t position_ = 0;
+        };
+
+
+        // Minimum size in bytes of the records, with all strings empty
+        const size_t MinModuleSize    = 3 * sizeof( int32_t ) + 2 * sizeof( uint32_t );      // plus the resource string from version 2
+        const size_t MinLinkSize      = 5 * sizeof( int32_t );
+        const size_t MinParameterSize = 2 * sizeof( int32_t ) + 2 * sizeof( int8_t ) + 9 * sizeof( double )
+                                      + 2 * sizeof( uint32_t ) + 4 * sizeof( int16_t ) + sizeof( int8_t );
+
+
+        void writeParameter( StateWriter& writer, const Parameter& p )
+        {
+            writer.put< int32_t >( p.getModuleId() );
+            writer.put< int32_t >( p.getId() );
+            writer.put< int8_t >( (int8_t)p.controlType_ );
+            writer.put< int8_t >( (int8_t)p.numberFormat_ );
+            writer.put< double >( p.value_ );
+            writer.put< double >( p.defaultValue_ );
+            writer.put< double >( p.veloSens_ );
+            writer.put< double >( p.keyTrack_ );
+            writer.put< double >( p.resolution_ );
+            writer.putString( p.label_ );
+            writer.putString( p.unit_ );
+
+            writer.put< double >( p.valueShaper_.getMin() );
+            writer.put< double >( p.valueShaper_.getMax() );
+            writer.put< int16_t >( (int16_t)p.valueShaper_.getNumSteps() );
+            writer.put< int16_t >( (int16_t)p.valueShaper_.getFactor() );
+
+            writer.put< int16_t >( (int16_t)p.midiShaper_.getControllerId() );
+            writer.put< int16_t >( (int16_t)p.midiShaper_.getControllerChannel() );
+            writer.put< double >( p.midiShaper_.getControllerMin() );
+            writer.put< double >( p.midiShaper_.getControllerMax() );
+            writer.put< int8_t >( p.midiShaper_.getSoftTakeover() ? 1 : 0 );
+        }
+
+
+        // Reads the fields after moduleId, id and controlType into p, see writeParameter()
+        void readParameter( StateReader& reader, const Parameter& p )
+        {
+            p.numberFormat_ = (NumberFormat)reader.get< int8_t >();
+            p.value_        = reader.get< double >();
+            p.defaultValue_ = reader.get< double >();
+            p.veloSens_     = reader.get< double >();
+            p.keyTrack_     = reader.get< double >();
+            p.resolution_   = reader.get< double >();
+            p.label_        = reader.getString();
+            p.unit_         = reader.getString();
+
+            p.valueShaper_.setMin( reader.get< double >() );
+            p.valueShaper_.setMax( reader.get< double >() );
+            p.valueShaper_.setNumSteps( reader.get< int16_t >() );
+            p.valueShaper_.setFactor( reader.get< int16_t >() );
+
+            p.midiShaper_.setControllerId( reader.get< int16_t >() );
+            p.midiShaper_.setControllerChannel( reader.get< int16_t >() );
+            p.midiShaper_.setControllerMin( reader.get< double >() );
+            p.midiShaper_.setControllerMax( reader.get< double >() );
+            p.midiShaper_.setSoftTakeover( reader.get< int8_t >() != 0 );
+        }
+
+
+        void updateParameterSet( const ParameterSet& source, ParameterSet& target, std::vector< ParameterChange >& changes )
+        {
+            for (ParameterSet::const_iterator it = source.begin(); it != source.end(); ++it)
+            {
+                ParameterSet::const_iterator pos = target.find( *it );
+                if (pos != target.end() && pos->value_ != it->value_)
+                {
+                    double previousValue = pos->value_;
+                    pos->value_          = it->value_;
+                    changes.push_back( ParameterChange( *pos, previousValue ) );
+                }
+            }
+        }
+
+
+        // The fields besides the value that are compiled into the modulation matrix and the controller map
+        bool hasSameSettings( const ParameterSet& source, const ParameterSet& target )
+        {
+            for (ParameterSet::const_iterator it = source.begin(); it != source.end(); ++it)
+            {
+                ParameterSet::const_iterator pos = target.find( *it );
+                if (pos == target.end()) return false;
+
+                const MidiParameterShaper& a = it->midiShaper_;
+                const MidiParameterShaper& b = pos->midiShaper_;
+                if (pos->veloSens_ != it->veloSens_ || pos->keyTrack_ != it->keyTrack_ ||
+                    a.getControllerId() != b.getControllerId() || a.getControllerChannel() != b.getControllerChannel() ||
+                    a.getControllerMin() != b.getControllerMin() || a.getControllerMax() != b.getControllerMax() ||
+                    a.getSoftTakeover() != b.getSoftTakeover())
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+
+        // FNV-1a
+        void hashValue( uint64_t& hash, int value )
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                hash ^= (uint8_t)(value >> (i * 8));
+                hash *= 1099511628211ull;
+            }
+        }
+
+        void hashString( uint64_t& hash, const std::string& s )
+        {
+            for (size_t i = 0; i < s.size(); i++)
+            {
+                hash ^= (uint8_t)s[i];
+                hash *= 1099511628211ull;
+            }
+        }
+    }
+
+
+    InstrumentState::InstrumentState( const Instrument* instrument )
+    {
+        ASSERT( instrument );
+
+        name_                    = instrument->name_;
+        attributes_.numVoices    = instrument->numVoices_;
+        attributes_.numUnison    = instrument->numUnison_;
+        attributes_.unisonSpread = instrument->unisonSpread_;
+        attributes_.hold         = instrument->hold_;
+        attributes_.retrigger    = instrument->retrigger_;
+        attributes_.legato       = instrument->legato_;
+        attributes_.mpe          = instrument->mpe_;
+        attributes_.stealPolicy  = instrument->stealPolicy_;
+
+        XmlElement* xml   = instrument->getXml();
+        XmlElement* panel = (xml != nullptr) ? xml->getChildByName( "panel" ) : nullptr;
+
+        const ModuleList& modules = instrument->getModules();
+        for (ModuleList::const_iterator it = modules.begin(); it != modules.end(); ++it)
+        {
+            const Module* module = *it;
+            ModuleState state;
+            state.id          = module->getId();
+            state.type        = module->moduleType_;
+            state.voicingType = module->getVoicingType();
+            state.label       = module->getLabel();
+            state.resource    = module->getResource();
+
+            XmlElement* e = (panel != nullptr) ? panel->getChildByAttribute( "id", String( state.id ) ) : nullptr;
+            if (e != nullptr) {
+                state.position = e->getStringAttribute( "pos" ).toStdString();
+            }
+            modules_.push_back( state );
+        }
+
+        const LinkSet& links = instrument->getLinks();
+        links_.assign( links.begin(), links.end() );
+
+        const Preset& preset = instrument->getCurrentPreset();
+        preset_ = Preset( preset.getId(), preset.getName() );
+        preset_.getModuleParameters() = preset.getModuleParameters();
+        preset_.getLinkParameters()   = preset.getLinkParameters();
+
+        graphHash_ = getGraphHash( instrument );
+    }
+
+
+    void InstrumentState::write( std::vector< char >& data ) const
+    {
+        data.clear();
+        StateWriter writer( data );
+
+        writer.put< uint32_t >( Magic );
+        writer.put< uint32_t >( Version );
+        writer.put< uint64_t >( graphHash_ );
+        writer.putString( name_ );
+
+        writer.put< int32_t >( attributes_.numVoices );
+        writer.put< int32_t >( attributes_.numUnison );
+        writer.put< int32_t >( attributes_.unisonSpread );
+        writer.put< int8_t >( attributes_.hold ? 1 : 0 );
+        writer.put< int8_t >( attributes_.retrigger ? 1 : 0 );
+        writer.put< int8_t >( attributes_.legato ? 1 : 0 );
+        writer.put< int8_t >( attributes_.mpe ? 1 : 0 );
+        writer.put< int32_t >( attributes_.stealPolicy );
+
+        writer.put< uint32_t >( (uint32_t)modules_.size() );
+        for (size_t i = 0; i < modules_.size(); i++)
+        {
+            const ModuleState& module = modules_[i];
+            writer.put< int32_t >( module.id );
+            writer.put< int32_t >( module.type );
+            writer.put< int32_t >( module.voicingType );
+            writer.putString( module.label );
+            writer.putString( module.position );
+            writer.putString( module.resource );
+        }
+
+        writer.put< uint32_t >( (uint32_t)links_.size() );
+        for (size_t i = 0; i < links_.size(); i++)
+        {
+            const Link& link = links_[i];
+            writer.put< int32_t >( link.getId() );
+            writer.put< int32_t >( link.leftModule_ );
+            writer.put< int32_t >( link.leftPort_ );
+            writer.put< int32_t >( link.rightModule_ );
+            writer.put< int32_t >( link.rightPort_ );
+        }
+
+        writer.put< int32_t >( preset_.getId() );
+        writer.putString( preset_.getName() );
+
+        const ParameterSet* sets[] = { &preset_.getModuleParameters(), &preset_.getLinkParameters() };
+        for (int s = 0; s < 2; s++)
+        {
+            writer.put< uint32_t >( (uint32_t)sets[s]->size() );
+            for (ParameterSet::const_iterator it = sets[s]->begin(); it != sets[s]->end(); ++it) {
+                writeParameter( writer, *it );
+            }
+        }
+    }
+
+
+    void InstrumentState::read( const void* data, size_t size )
+    {
+        StateReader reader( data, size );
+
+        if (reader.get< uint32_t >() != Magic) {
+            THROW( std::runtime_error, "Data is no instrument state" );
+        }
+        uint32_t version = reader.get< uint32_t >();
+        if (version < 1 || version > Version) {
+            THROW( std::runtime_error, "Unsupported instrument state version %u", version );
+        }
+        graphHash_ = reader.get< uint64_t >();
+        name_      = reader.getString();
+
+        attributes_.numVoices    = reader.get< int32_t >();
+        attributes_.numUnison    = reader.get< int32_t >();
+        attributes_.unisonSpread = reader.get< int32_t >();
+        attributes_.hold         = reader.get< int8_t >() != 0;
+        attributes_.retrigger    = reader.get< int8_t >() != 0;
+        attributes_.legato       = reader.get< int8_t >() != 0;
+        attributes_.mpe          = reader.get< int8_t >() != 0;
+        attributes_.stealPolicy  = reader.get< int32_t >();
+
+        modules_.resize( reader.getCount( MinModuleSize + ((version >= 2) ? sizeof( uint32_t ) : 0) ) );
+        for (size_t i = 0; i < modules_.size(); i++)
+        {
+            ModuleState& module = modules_[i];
+            module.id          = reader.get< int32_t >();
+            module.type        = reader.get< int32_t >();
+            module.voicingType = reader.get< int32_t >();
+            module.label       = reader.getString();
+            module.position    = reader.getString();
+            module.resource    = (version >= 2) ? reader.getString() : std::string();
+        }
+
+        links_.resize( reader.getCount( MinLinkSize ) );
+        for (size_t i = 0; i < links_.size(); i++)
+        {
+            Link& link = links_[i];
+            link.setId( reader.get< int32_t >() );
+            link.leftModule_  = reader.get< int32_t >();
+            link.leftPort_    = reader.get< int32_t >();
+            link.rightModule_ = reader.get< int32_t >();
+            link.rightPort_   = reader.get< int32_t >();
+        }
+
+        int presetId = reader.get< int32_t >();
+        preset_      = Preset( presetId, reader.getString() );
+
+        ParameterSet& moduleParameters = preset_.getModuleParameters();
+        for (uint32_t n = reader.getCount( MinParameterSize ); n > 0; n--)
+        {
+            int moduleId            = reader.get< int32_t >();
+            int id                  = reader.get< int32_t >();
+            ControlType controlType = (ControlType)reader.get< int8_t >();
+            const Parameter& p      = moduleParameters.addModuleParameter( id, moduleId, "", controlType );
+            readParameter( reader, p );
+        }
+
+        ParameterSet& linkParameters = preset_.getLinkParameters();
+        for (uint32_t n = reader.getCount( MinParameterSize ); n > 0; n--)
+        {
+            int moduleId = reader.get< int32_t >();
+            int id       = reader.get< int32_t >();
+            reader.get< int8_t >();                 // always a slider
+            const Parameter& p = linkParameters.addLinkParameter( id, moduleId );
+            readParameter( reader, p );
+        }
+    }
+
+
+    void InstrumentState::restore( Instrument* instrument ) const
+    {
+        ASSERT( instrument );
+        ASSERT( instrument->getNumModules() == 0 );
+
+        instrument->name_         = name_;
+        instrument->numVoices_    = attributes_.numVoices;
+        instrument->numUnison_    = attributes_.numUnison;
+        instrument->unisonSpread_ = attributes_.unisonSpread;
+        instrument->hold_         = attributes_.hold;
+        instrument->retrigger_    = attributes_.retrigger;
+        instrument->legato_       = attributes_.legato;
+        instrument->mpe_          = attributes_.mpe;
+        instrument->stealPolicy_  = attributes_.stealPolicy;
+
+        XmlElement* xml   = instrument->getXml();
+        XmlElement* panel = nullptr;
+        if (xml != nullptr)
+        {
+            panel = xml->getChildByName( "panel" );
+            if (panel == nullptr) {
+                panel = xml->createNewChildElement( "panel" );
+            }
+        }
+
+        for (size_t i = 0; i < modules_.size(); i++)
+        {
+            const ModuleState& state = modules_[i];
+            Module* module = instrument->createAndAddModule( (ModuleType)state.type, state.id );
+            module->setLabel( state.label );
+            module->setResource( state.resource );
+            module->setVoicingType( (VoicingType)state.voicingType );
+
+            if (panel != nullptr && state.position.empty() == false)
+            {
+                XmlElement* e = panel->createNewChildElement( "module" );
+                e->setAttribute( "id", state.id );
+                e->setAttribute( "pos", String( state.position ) );
+            }
+        }
+
+        for (size_t i = 0; i < links_.size(); i++)
+        {
+            Link link = links_[i];
+            instrument->addLink( link, false );
+        }
+
+        // the module parameters start from the defaults of the module, like InstrumentSerializer::readPresets()
+        PresetSet& presetSet = const_cast< PresetSet& >( instrument->getPresets() );
+        presetSet.clear();                                              // e.g. the default preset of an empty instrument
+        int presetId         = std::max<int>( 0, preset_.getId() );     // -1: the instrument had no preset loaded
+        const Preset& preset = presetSet.addPreset( presetId, preset_.getName() );
+
+        const ParameterSet& moduleParameters = preset_.getModuleParameters();
+        for (ParameterSet::const_iterator it = moduleParameters.begin(); it != moduleParameters.end(); ++it)
+        {
+            Module* module = instrument->getModule( it->getModuleId() );
+            if (module != nullptr)
+            {
+                Parameter p = module->getDefaultParameter( it->getId() );
+                p.controlType_  = it->controlType_;
+                p.numberFormat_ = it->numberFormat_;
+                p.value_        = it->value_;
+                p.defaultValue_ = it->defaultValue_;
+                p.veloSens_     = it->veloSens_;
+                p.keyTrack_     = it->keyTrack_;
+                p.resolution_   = it->resolution_;
+                p.label_        = it->label_;
+                p.unit_         = it->unit_;
+                p.valueShaper_  = it->valueShaper_;
+                p.midiShaper_   = it->midiShaper_;
+                preset.getModuleParameters().add( p );
+            }
+        }
+        preset.getLinkParameters() = preset_.getLinkParameters();
+        presetSet.setCurrentPresetId( presetId );
+    }
+
+
+    bool InstrumentState::matches( const Instrument* instrument ) const
+    {
+        const Preset& preset = instrument->getCurrentPreset();
+
+        return graphHash_ == getGraphHash( instrument ) &&
+               preset_.getId() == preset.getId() &&
+               hasSameSettings( preset_.getModuleParameters(), preset.getModuleParameters() ) &&
+               hasSameSettings( preset_.getLinkParameters(), preset.getLinkParameters() );
+    }
+
+
+    void InstrumentState::updateParameters( const Preset& preset, std::vector< ParameterChange >& changes ) const
+    {
+        updateParameterSet( preset_.getModuleParameters(), preset.getModuleParameters(), changes );
+        updateParameterSet( preset_.getLinkParameters(), preset.getLinkParameters(), changes );
+    }
+
+
+    // Modules, their resources and links, but not labels or parameters, which change without a rebuild.
+    //
+    uint64_t InstrumentState::getGraphHash( const Instrument* instrument )
+    {
+        std::vector< const Module* > modules( instrument->getModules().begin(), instrument->getModules().end() );
+        std::sort( modules.begin(), modules.end(), []( const Module* a, const Module* b ) {
+            return a->getId() < b->getId();
+        } );
+
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < modules.size(); i++)
+        {
+            hashValue( hash, modules[i]->getId() );
+            hashValue( hash, modules[i]->moduleType_ );
+            hashValue( hash, modules[i]->getVoicingType() );
+            hashString( hash, modules[i]->getResource() );     // another sample needs a new init()
+        }
+
+        const LinkSet& links = instrument->getLinks();
+        for (LinkSet::const_iterator it = links.begin(); it != links.end(); ++it)
+        {
+            hashValue( hash, it->getId() );
+            hashValue( hash, it->leftModule_ );
+            hashValue( hash, it->leftPort_ );
+            hashValue( hash, it->rightModule_ );
+            hashValue( hash, it->rightPort_ );
+        }
+        return hash;
+    }
+
+} // namespace e3
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "core/Preset.h"
+#include "core/Link.h"
+#include "core/ParameterQueue.h"
+
+
+namespace e3 {
+
+    class Instrument;
+
+    //--------------------------------------------------------------------------
+    // class InstrumentState
+    // Compact binary snapshot of an instrument for the plugin state in the
+    // host project: attributes, modules, links, module positions and the
+    // parameters of the current preset. Reading a snapshot needs no XML.
+    // The graph hash tells whether a snapshot belongs to the instrument that
+    // is loaded already. If the preset is the same as well, only the parameter
+    // values that differ have to be applied and the modules stay as they are.
+    // Numbers are stored in the byte order of the machine.
+    //--------------------------------------------------------------------------
+
+    class InstrumentState
+    {
+    public:
+        enum {
+            Magic   = 0x54533345,       // "E3ST"
+            Version = 2             // 2: module resources
+        };
+
+        struct Attributes
+        {
+            int numVoices    = 1;
+            int numUnison    = 1;
+            int unisonSpread = 5;
+            bool hold        = false;
+            bool retrigger   = false;
+            bool legato      = false;
+            bool mpe         = false;
+            int stealPolicy  = 0;
+        };
+
+        struct ModuleState
+        {
+            int id          = -1;
+            int type        = 0;
+            int voicingType = 0;
+            std::string label;
+            std::string position;       // "x y" of the module panel, empty if unknown
+            std::string resource;       // see Module::getResource()
+        };
+
+        InstrumentState() {}
+        explicit InstrumentState( const Instrument* instrument );
+
+        void write( std::vector< char >& data ) const;
+        void read( const void* data, size_t size );         // throws std::runtime_error if the data is no valid state
+
+        // Fills an empty instrument with modules, links and the preset of this state,
+        // which replaces the presets of the instrument.
+        void restore( Instrument* instrument ) const;
+
+        // Copies the values that differ into the preset and returns them as changes.
+        void updateParameters( const Preset& preset, std::vector< ParameterChange >& changes ) const;
+
+        // True if the state has the graph and the preset of the instrument and differs only in
+        // values, see updateParameters(). Other modulation or controller settings need a rebuild.
+        bool matches( const Instrument* instrument ) const;
+        static uint64_t getGraphHash( const Instrument* instrument );
+
+        const Attributes& getAttributes() const             { return attributes_; }
+        const Preset& getPreset() const                     { return preset_; }
+
+    protected:
+        std::string name_;
+        Attributes attributes_;
+        std::vector< ModuleState > modules_;
+        std::vector< Link > links_;
+        Preset preset_;
+        uint64_t graphHash_ = 0;
+    };
+
+} // namespace e3
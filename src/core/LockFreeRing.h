@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class LockFreeRing
+    // Bounded queue for several producers and consumers, after Dmitry Vyukov.
+    // Every cell carries a sequence number that tells whether it is free for
+    // the next push or pop. Neither side blocks or allocates, push() fails
+    // while the ring is full. Capacity must be a power of two.
+    //--------------------------------------------------------------------------
+
+    template< class T, uint32_t Capacity >
+    class LockFreeRing
+    {
+    public:
+        LockFreeRing() : pushPosition_( 0 ), popPosition_( 0 ), numDropped_( 0 )
+        {
+            static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+            for (uint32_t i = 0; i < Capacity; i++) {
+                cells_[i].sequence.store( i, std::memory_order_relaxed );
+            }
+        }
+
+        bool push( const T& item )
+        {
+            Cell* cell;
+            uint32_t position = pushPosition_.load( std::memory_order_relaxed );
+            for (;;)
+            {
+                cell = &cells_[position & Mask];
+                int32_t diff = (int32_t)(cell->sequence.load( std::memory_order_acquire ) - position);
+                if (diff == 0) {
+                    if (pushPosition_.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ))
+                        break;
+                }
+                else if (diff < 0) {
+                    numDropped_++;
+                    return false;
+                }
+                else {
+                    position = pushPosition_.load( std::memory_order_relaxed );
+                }
+            }
+            cell->item = item;
+            cell->sequence.store( position + 1, std::memory_order_release );
+            return true;
+        }
+
+        bool pop( T& item )
+        {
+            Cell* cell;
+            uint32_t position = popPosition_.load( std::memory_order_relaxed );
+            for (;;)
+            {
+                cell = &cells_[position & Mask];
+                int32_t diff = (int32_t)(cell->sequence.load( std::memory_order_acquire ) - (position + 1));
+                if (diff == 0) {
+                    if (popPosition_.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ))
+                        break;
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    position = popPosition_.load( std::memory_order_relaxed );
+                }
+            }
+            item = cell->item;
+            cell->sequence.store( position + Mask + 1, std::memory_order_release );
+            return true;
+        }
+
+        void clear()
+        {
+            T item;
+            while (pop( item ));
+        }
+
+        int getNumDropped() const   { return numDropped_.load(); }
+
+    private:
+        enum { Mask = Capacity - 1 };
+
+        struct Cell
+        {
+            std::atomic< uint32_t > sequence;
+            T item;
+        };
+
+        Cell cells_[Capacity];
+        std::atomic< uint32_t > pushPosition_;
+        std::atomic< uint32_t > popPosition_;
+        std::atomic< int > numDropped_;
+    };
+
+} // namespace e3
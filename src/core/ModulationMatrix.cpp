@@ -0,0 +1,192 @@
+
+#include <algorithm>
+#include <e3_Exception.h>
+#include "core/Instrument.h"
+#include "core/Module.h"
+#include "core/Port.h"
+#include "core/ModulationMatrix.h"
+
+
+namespace e3 {
+
+    ModulationMatrix::ModulationMatrix()
+    {
+        clear();
+    }
+
+
+    void ModulationMatrix::clear()
+    {
+        destinations_.clear();
+        entries_.clear();
+        sources_.clear();
+        numVoices_  = 0;
+        firstDirty_ = 0;
+        lastDirty_  = -1;
+    }
+
+
+    void ModulationMatrix::compile( Instrument* instrument, int numVoices )
+    {
+        clear();
+        numVoices_ = numVoices;
+        sources_.resize( NumSources * numVoices_, 0 );
+
+        const ModuleList& modules = instrument->getModules();
+        for (ModuleList::const_iterator it = modules.begin(); it != modules.end(); ++it)
+        {
+            const OutportList& outports = (*it)->getOutports();
+            for (OutportList::const_iterator pit = outports.begin(); pit != outports.end(); ++pit)
+            {
+                Outport* port = *pit;
+                addDestinations( port->audioData_, &port->audioModulationBuffer_, port->numVoices_ );
+                addDestinations( port->eventData_, &port->eventModulationBuffer_, port->numVoices_ );
+            }
+        }
+        invalidate( -1 );
+    }
+
+
+    void ModulationMatrix::addDestinations( const std::vector< PortData >& data, ModulationBuffer* buffer, int numVoices )
+    {
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            const PortData& link = data[i];
+            if (link.veloSens_ == 0 && link.keyTrack_ == 0) continue;
+
+            Destination destination;
+            destination.data       = &data;
+            destination.buffer     = buffer;
+            destination.index      = (int)i;
+            destination.numVoices  = numVoices;
+            destination.value      = link.value_;
+            destination.firstEntry = (int)entries_.size();
+
+            if (link.veloSens_ != 0) {
+                Entry entry = { SourceVelocity, link.veloSens_ };
+                entries_.push_back( entry );
+            }
+            if (link.keyTrack_ != 0) {
+                Entry entry = { SourceKey, link.keyTrack_ };
+                entries_.push_back( entry );
+            }
+            destination.numEntries = (int)entries_.size() - destination.firstEntry;
+            destinations_.push_back( destination );
+        }
+    }
+
+
+    void ModulationMatrix::processVoiceEvents( const VoiceEventList& events )
+    {
+        for (VoiceEventList::const_iterator it = events.begin(); it != events.end(); ++it)
+        {
+            const VoiceEvent& e = *it;
+            if (e.voice_ >= numVoices_) continue;
+
+            switch (e.type_)
+            {
+            case VoiceEvent::Note:
+                if (e.voice_ < 0) break;
+                sources_[SourceKey * numVoices_ + e.voice_] = (e.pitch_ - 60) / 12;
+                if (e.gateChanged_ && e.gate_ > 0) {
+                    sources_[SourceVelocity * numVoices_ + e.voice_] = e.gate_;
+                }
+                invalidate( e.voice_ );
+                break;
+            case VoiceEvent::Pressure: setSource( SourceAftertouch, e.voice_, e.value_ ); break;
+            case VoiceEvent::Timbre:   setSource( SourceTimbre, e.voice_, e.value_ );     break;
+            default: break;
+            }
+        }
+    }
+
+
+    void ModulationMatrix::setSource( int source, int voice, double value )
+    {
+        ASSERT( source >= 0 && source < NumSources );
+        ASSERT( voice < numVoices_ );
+        if (numVoices_ == 0) return;
+
+        if (voice < 0) {
+            std::fill_n( &sources_[source * numVoices_], numVoices_, value );
+        }
+        else {
+            sources_[source * numVoices_ + voice] = value;
+        }
+        invalidate( voice );
+    }
+
+
+    double ModulationMatrix::getSource( int source, int voice ) const
+    {
+        ASSERT( source >= 0 && source < NumSources );
+        ASSERT( voice >= 0 && voice < numVoices_ );
+
+        return sources_[source * numVoices_ + voice];
+    }
+
+
+    // Evaluates the voices that changed since the last call, and all voices of
+    // the destinations whose link value has changed. Called once per control block.
+    //
+    void ModulationMatrix::update()
+    {
+        int first = firstDirty_;
+        int last  = lastDirty_;
+
+        for (size_t i = 0; i < destinations_.size(); i++)
+        {
+            Destination& destination = destinations_[i];
+            ASSERT( destination.index < (int)destination.data->size() );   // compile() after each change of the links
+
+            double value = (*destination.data)[destination.index].value_;
+            if (value != destination.value) {
+                destination.value = value;
+                evaluate( destination, 0, numVoices_ - 1 );
+            }
+            else if (first <= last) {
+                evaluate( destination, first, last );
+            }
+        }
+        firstDirty_ = numVoices_;
+        lastDirty_  = -1;
+    }
+
+
+    void ModulationMatrix::evaluate( Destination& destination, int first, int last )
+    {
+        last = std::min<int>( last, destination.numVoices - 1 );   // monophonic links use voice 0
+        if (first > last) return;
+
+        double* values = destination.buffer->getValues( destination.index );
+        double value   = destination.value;
+
+        for (int v = first; v <= last; v++) {
+            values[v] = value;
+        }
+        for (int i = destination.firstEntry; i < destination.firstEntry + destination.numEntries; i++)
+        {
+            const Entry& entry    = entries_[i];
+            const double* source  = &sources_[entry.source * numVoices_];
+            double amount         = entry.amount;
+
+            for (int v = first; v <= last; v++) {
+                values[v] += amount * source[v];
+            }
+        }
+    }
+
+
+    void ModulationMatrix::invalidate( int voice )
+    {
+        if (voice < 0) {
+            firstDirty_ = 0;
+            lastDirty_  = numVoices_ - 1;
+        }
+        else {
+            firstDirty_ = std::min<int>( firstDirty_, voice );
+            lastDirty_  = std::max<int>( lastDirty_, voice );
+        }
+    }
+
+} // namespace e3
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include "core/Voice.h"
+
+
+namespace e3 {
+
+    class Instrument;
+    class PortData;
+    class ModulationBuffer;
+
+    //--------------------------------------------------------------------------
+    // class ModulationMatrix
+    // Per voice modulation of the links. Every voice has one value per source
+    // (velocity, key, pressure, timbre), and each link that is sensitive to a source
+    // becomes a destination with one entry per source.
+    // compile() collects the destinations into flat lists, update() evaluates
+    // them for the voices that have changed since the last control block.
+    // Values are computed for a range of voices at a time, in loops over
+    // contiguous per voice arrays that the compiler vectorizes.
+    //--------------------------------------------------------------------------
+
+    class ModulationMatrix
+    {
+    public:
+        enum Source {
+            SourceVelocity   = 0,     // gate of the last note on, 0..1
+            SourceKey        = 1,     // octaves from middle C
+            SourceAftertouch = 2,     // channel, key or MPE pressure, 0..1
+            SourceTimbre     = 3,     // MPE timbre, 0..1
+            NumSources
+        };
+
+        ModulationMatrix();
+
+        // Message thread, while processing is suspended.
+        void compile( Instrument* instrument, int numVoices );
+        void clear();
+
+        // Audio thread.
+        void processVoiceEvents( const VoiceEventList& events );
+        void setSource( int source, int voice, double value );      // voice -1: all voices
+        void update();
+
+        int getNumDestinations() const             { return (int)destinations_.size(); }
+        int getNumEntries() const                  { return (int)entries_.size(); }
+        double getSource( int source, int voice ) const;
+
+    protected:
+        struct Entry
+        {
+            int source;
+            double amount;
+        };
+
+        // The link is addressed by its index in the data of its port, pointers
+        // into the data would not survive a reconnection of the port.
+        struct Destination
+        {
+            const std::vector< PortData >* data;
+            ModulationBuffer* buffer;   // numVoices values per link
+            int index;
+            int numVoices;
+            double value;               // link value of the last evaluation
+            int firstEntry;
+            int numEntries;
+        };
+
+        void addDestinations( const std::vector< PortData >& data, ModulationBuffer* buffer, int numVoices );
+        void evaluate( Destination& destination, int first, int last );
+        void invalidate( int voice );
+
+        std::vector< Destination > destinations_;
+        std::vector< Entry > entries_;
+        std::vector< double > sources_;             // NumSources * numVoices_, voices contiguous
+
+        int numVoices_  = 0;
+        int firstDirty_ = 0;                        // voices to be evaluated by update()
+        int lastDirty_  = -1;
+    };
+
+} // namespace e3
@@ -33,13 +33,15 @@ namespace e3 {
     }
 
 
-    void Module::init( double sampleRate, int numVoices, Polyphony* polyphony )
+    void Module::init( double sampleRate, int numVoices, Polyphony* polyphony, Arena* arena )
     {
         ASSERT( sampleRate > 0 );
         ASSERT( numVoices > 0 );
         ASSERT( polyphony != nullptr );
+        ASSERT( arena != nullptr );
 
         polyphony_  = polyphony;
+        arena_      = arena;
         setNumVoices( numVoices );
         initData();
         setSampleRate( sampleRate );
@@ -55,6 +57,7 @@ namespace e3 {
         sampleRate_ = 0;
         numVoices_  = 0;
         polyphony_  = nullptr;
+        arena_      = nullptr;
     }
 
 
@@ -63,6 +66,8 @@ namespace e3 {
         ASSERT( sampleRate_ > 0 );
         ASSERT( numVoices_ > 0 );
 
+        fusedSource_     = nullptr;
+        fusedModulation_ = nullptr;
         updatePorts();
     }
 
@@ -71,6 +76,7 @@ namespace e3 {
     {
         for (size_t i = 0; i < inports_.size(); i++) {
             inports_[i]->setNumVoices( numVoices_ );
+            inports_[i]->setAudioBuffer( allocate< double >( numVoices_, 0 ) );
         }
         for (size_t i = 0; i < outports_.size(); i++) {
             outports_[i]->setNumVoices( numVoices_ );
@@ -100,7 +106,7 @@ namespace e3 {
     }
 
 
-    void Module::addInport( int portId, const std::string& label, Inport* port )
+    void Module::addInport( int portId, const std::string& label, Inport* port, EventSetter setter )
     {
         ASSERT( port );
         ASSERT( port->getType() & PortTypeInport );
@@ -108,6 +114,7 @@ namespace e3 {
         port->setId( portId );
         port->setLabel( label );
         port->setOwner( this );
+        port->setEventSetter( setter );
         inports_.insert( inports_.begin() + portId, port );
     }
 
@@ -161,6 +168,12 @@ namespace e3 {
     //}
 
 
+    void Module::setParameterEvent( Module* module, int paramId, double value, double modulation, int voice )
+    {
+        module->setParameter( paramId, value, modulation, voice );
+    }
+
+
     VoiceAdapterType Module::selectVoiceAdapter( VoicingType otherVoicingType ) const
     {
         return (voicingType_ == otherVoicingType) ? AdapterNone :
@@ -187,14 +200,19 @@ namespace e3 {
         if (parameter.isModuleType()) {
             setParameter( parameter.getId(), parameter.value_ );
         }
-        else if (parameter.isLinkType())
+        else if (parameter.isLinkType()) {
+            setLinkParameter( parameter.getId(), parameter.value_ );
+        }
+    }
+
+
+    void Module::setLinkParameter( int linkId, double value )
+    {
+        for (OutportList::const_iterator it = outports_.begin(); it != outports_.end(); ++it)
         {
-            for (OutportList::const_iterator it = outports_.begin(); it != outports_.end(); ++it)
-            {
-                Outport* outport = *it;
-                if (outport->setParameter( parameter )) {
-                    break;
-                }
+            Outport* outport = *it;
+            if (outport->setParameter( linkId, value )) {
+                break;
             }
         }
     }
@@ -5,9 +5,11 @@
 #include <string>
 
 #include "core/GlobalHeader.h"
+#include "core/Arena.h"
 #include "core/Port.h"
 #include "core/Link.h"
 #include "core/Parameter.h"
+#include "core/Voice.h"
 
 #pragma warning(push)
 #pragma warning(disable: 4100) 
@@ -22,6 +24,33 @@ namespace e3 {
     // Pointer type to the audio processing function of a module.
     typedef void ( Module::*ProcessFunctionPointer )( void ) throw( );
 
+
+    //--------------------------------------------------------------------------
+    // struct ProcessFunctionSelector
+    // Maps runtime flags (mono, connected inports, ...) to the matching 
+    // compile time instantiation of a process function, so the flags cost
+    // nothing inside the voice loop.
+    // Kernels must provide: template< bool... > static ProcessFunctionPointer get();
+    // Usage: processFunction_ = ProcessFunctionSelector< Kernels >::select( mono_, fm, am );
+    //--------------------------------------------------------------------------
+
+    template< class Kernels, bool... Flags >
+    struct ProcessFunctionSelector
+    {
+        static ProcessFunctionPointer select()
+        {
+            return Kernels::template get< Flags... >();
+        }
+
+        template< class... Rest >
+        static ProcessFunctionPointer select( bool flag, Rest... rest )
+        {
+            return flag ?
+                ProcessFunctionSelector< Kernels, Flags..., true >::select( rest... ) :
+                ProcessFunctionSelector< Kernels, Flags..., false >::select( rest... );
+        }
+    };
+
     enum ModuleType {
         ModuleTypeUndefined = -1,
 
@@ -30,11 +59,19 @@ namespace e3 {
         ModuleTypeMidiGate = 1,
         ModuleTypeMidiFrequency = 2,
         ModuleTypeMidiInput = 3,
+        ModuleTypeAudioInTerminal = 4,
 
         // audio
         ModuleTypeSineOscillator = 10,
         ModuleTypeAdsrEnvelope = 11,
         ModuleTypeDelay = 12,
+        ModuleTypePan = 13,
+        ModuleTypeSvfFilter = 14,
+        ModuleTypeLfo = 15,
+        ModuleTypeSampler = 16,
+        ModuleTypeReverb = 17,
+        ModuleTypeNoise = 18,
+        ModuleTypeSampleAndHold = 19,
     };
 
 
@@ -84,6 +121,9 @@ namespace e3 {
         virtual void processEvent( double value, uint16_t voices ) throw( ) {}
         virtual void processControl() throw ( ) {}
 
+        // Receives the note and pitchbend events of one MIDI message, see Sink::processVoiceEvents().
+        virtual void processVoiceEvents( const VoiceEventList& events ) {}
+
         virtual void onMidiController( int controllerNum, int value );
 
         virtual void suspend() {}
@@ -96,6 +136,7 @@ namespace e3 {
         virtual const Parameter& getDefaultParameter( int parameterId ) const;
         virtual void setParameter( int paramId, double value, double modulation = 0.f, int voice = -1 ) {}
         virtual void setParameter( const Parameter& parameter );
+        void setLinkParameter( int linkId, double value );
 
         const InportList& getInports() const           { return inports_; }
         const OutportList& getOutports() const         { return outports_; }
@@ -109,24 +150,31 @@ namespace e3 {
         const std::string& getLabel() const            { return label_; }
         void setLabel( const std::string& label )      { label_ = label; }
         VoicingType getVoicingType() const             { return voicingType_; }
-        void setVoicingType( VoicingType type )        { voicingType_ = type; }
+        void setVoicingType( VoicingType type )        { voicingType_ = type; mono_ = type == Monophonic; }
+
+        // File the module plays from, e.g. the sample of a Sampler, empty for most modules.
+        // Read by initData(), so a new resource needs a new init().
+        const std::string& getResource() const         { return resource_; }
+        void setResource( const std::string& path )    { resource_ = path; }
+
+        // Graph fusion, see Sink::fuseModules().
+        // A fusable source computes its output on request of the target it feeds.
+        // fuseSource() lets the target take over the processing of source.
+        virtual bool isFusableSource() const                        { return false; }
+        virtual bool fuseSource( Module* source, const Link& link ) { return false; }
                                                        
+        // Sink::process() reads processingType_ and processFunction_ of every module
+        // each frame, they stay close to the vtable pointer.
         const ModuleType moduleType_;
         const ProcessingType processingType_;
         const ModuleStyle moduleStyle_;
 
     protected:
-        std::string label_;
-        int id_ = -1;
-        VoicingType voicingType_;
-
-        InportList inports_;
-        OutportList outports_;
-
         ProcessFunctionPointer processFunction_ = nullptr;
 
         // Constructs all member and initializes them with the current sample rate and number of voices.
-        virtual void init( double sampleRate, int numVoices, Polyphony* polyphony );
+        // Per voice state is allocated from arena, the arena of the Instrument.
+        virtual void init( double sampleRate, int numVoices, Polyphony* polyphony, Arena* arena );
 
         // Update after all modules are connected. Links remain valid.
         virtual void update();
@@ -144,16 +192,42 @@ namespace e3 {
         void connect( Module* target, const PortData& data );
         void disconnect( Module* target, const Link& link );
 
-        void addInport( int portId, const std::string& label, Inport* port );
+        // setter is called for events arriving at the inport. The default forwards to setParameter().
+        void addInport( int portId, const std::string& label, Inport* port, EventSetter setter = &Module::setParameterEvent );
         void addOutport( int portId, const std::string& label, Outport* port, PortType portType );
 
         VoiceAdapterType selectVoiceAdapter( VoicingType other ) const;
 
-        double sampleRate_ = INITIAL_SAMPLERATE;
-        int numVoices_     = 0;
-        bool mono_         = false;
+        // EventSetter that calls Setter directly, without the virtual dispatch and the switch of setParameter().
+        // Usage: addInport( 0, "Gate", &gateInport_, &eventSetter< AdsrEnvelope, &AdsrEnvelope::setGate > );
+        template< class M, void ( M::*Setter )( double, double, int ) >
+        static void eventSetter( Module* module, int, double value, double modulation, int voice )
+        {
+            ( static_cast<M*>( module )->*Setter )( value, modulation, voice );
+        }
+        static void setParameterEvent( Module* module, int paramId, double value, double modulation, int voice );
+
+        // Allocates DSP state during initData(). The memory stays valid until the next init().
+        template< class T > T* allocate( size_t size, T value = T() )  { return arena_->allocate< T >( size, value ); }
+
+        // Cold members, used while the instrument is built.
+        std::string label_;
+        std::string resource_;
+        int id_ = -1;
+        VoicingType voicingType_;
+
+        InportList inports_;
+        OutportList outports_;
 
-        Polyphony* polyphony_ = nullptr;
+        double sampleRate_ = INITIAL_SAMPLERATE;
+        Arena* arena_      = nullptr;
+
+        // Hot members, used by the kernels. They come last, next to the DSP state of the derived class.
+        Polyphony* polyphony_           = nullptr;
+        Module* fusedSource_            = nullptr;
+        const double* fusedModulation_  = nullptr;
+        int numVoices_                  = 0;
+        bool mono_                      = false;
 
     private: // Make non copyable and prevent C4512
         Module( const Module& ) = delete;
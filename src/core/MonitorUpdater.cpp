@@ -1,56 +1,94 @@
 
+#include "core/AllocationGuard.h"
 #include "core/MonitorUpdater.h"
 
 namespace e3 {
 
+    MonitorUpdater::MonitorUpdater() :
+        head_( 0 ),
+        tail_( 0 )
+    {}
+
+
     void MonitorUpdater::monitorVoiceEvent(int numSounding)
     {
-        pendingEvents_.push_back(MonitorEvent(MonitorVoices, -1, -1, numSounding));
-        triggerAsyncUpdate();
+        post(MonitorEvent(MonitorVoices, -1, -1, numSounding));
     }
 
 
     void MonitorUpdater::monitorCpuMeterEvent(double value)
     {
-        pendingEvents_.push_back(MonitorEvent(MonitorCpuMeter, value));
-        triggerAsyncUpdate();
+        post(MonitorEvent(MonitorCpuMeter, value));
     }
 
 
 	void MonitorUpdater::monitorProcessorStateEvent( double value )
 	{
-		pendingEvents_.push_back( MonitorEvent( MonitorProcessorState, value ) );
-		triggerAsyncUpdate();
+		post( MonitorEvent( MonitorProcessorState, value ) );
 	}
 	
 	
 	void MonitorUpdater::monitorNoteEvent( double pitch, double gate )
     {
-        pendingEvents_.push_back(MonitorEvent(MonitorNote, pitch, gate));
-        triggerAsyncUpdate();
+        post(MonitorEvent(MonitorNote, pitch, gate));
     }
 
 
     void MonitorUpdater::monitorControllerEvent(int controllerId, int value)
     {
-        pendingEvents_.push_back(MonitorEvent(MonitorController, controllerId, value));
-        triggerAsyncUpdate();
+        post(MonitorEvent(MonitorController, controllerId, value));
     }
 
 
     void MonitorUpdater::monitorPitchbendEvent(int value)
     {
-        pendingEvents_.push_back(MonitorEvent(MonitorPitchbend, value));
+        post(MonitorEvent(MonitorPitchbend, value));
+    }
+
+
+    void MonitorUpdater::post( const MonitorEvent& e )
+    {
+        if (AllocationGuard::isGuarded() == false)
+        {
+            if (MessageManager::existsAndIsCurrentThread()) {
+                monitorUpdateSignal( e );
+            }
+            else {
+                const ScopedLock scopedLock( queueLock_ );
+                queuedEvents_.push_back( e );
+                triggerAsyncUpdate();
+            }
+            return;
+        }
+
+        uint32_t head = head_.load( std::memory_order_relaxed );
+        if (head - tail_.load( std::memory_order_acquire ) >= Capacity) {
+            return;
+        }
+        pendingEvents_[head & (Capacity - 1)] = e;
+        head_.store( head + 1, std::memory_order_release );
         triggerAsyncUpdate();
     }
 
 
     void MonitorUpdater::handleAsyncUpdate()
     {
-        for (size_t i = 0; i < pendingEvents_.size(); i++) {
-            monitorUpdateSignal(pendingEvents_[i]);
+        uint32_t tail = tail_.load( std::memory_order_relaxed );
+        uint32_t head = head_.load( std::memory_order_acquire );
+
+        for (; tail != head; tail++) {
+            monitorUpdateSignal( pendingEvents_[tail & (Capacity - 1)] );
+        }
+        tail_.store( tail, std::memory_order_release );
+
+        std::vector< MonitorEvent > queued;
+        {
+            const ScopedLock scopedLock( queueLock_ );
+            queued.swap( queuedEvents_ );
+        }
+        for (size_t i = 0; i < queued.size(); i++) {
+            monitorUpdateSignal( queued[i] );
         }
-        pendingEvents_.clear();
     }
 
 
@@ -1,6 +1,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <atomic>
+#include <vector>
 #include "JuceHeader.h"
 #include "core/GlobalHeader.h"
 
@@ -19,7 +22,7 @@ namespace e3 {
 
     struct MonitorEvent 
     {
-        MonitorEvent(MonitorEventType type, double value1=-1, double value2=-1, int numVoices=-1) :
+        MonitorEvent(MonitorEventType type=MonitorNote, double value1=-1, double value2=-1, int numVoices=-1) :
             type(type),
             numVoices(numVoices),
             value1(value1),
@@ -32,9 +35,23 @@ namespace e3 {
         double value2;
     };
 
+    //--------------------------------------------------------------------------
+    // class MonitorUpdater
+    // Passes monitor events to the GUI. Events from the message thread are sent
+    // at once. The audio thread, i.e. a scope marked by an AllocationGuard,
+    // is the only producer of a lock-free ring that handleAsyncUpdate() drains,
+    // so processBlock() never allocates or locks. Events are dropped while the
+    // ring is full. Any other thread, e.g. a host thread that loads a state,
+    // queues its events under a lock.
+    //--------------------------------------------------------------------------
+
     class MonitorUpdater : public AsyncUpdater
     {
     public:
+        enum { Capacity = 256 };            // must be a power of two
+
+        MonitorUpdater();
+
         Gallant::Signal1<MonitorEvent> monitorUpdateSignal;
 
         void monitorVoiceEvent(int numSounding);
@@ -46,9 +63,15 @@ namespace e3 {
         void monitorPitchbendEvent(int value);
 
     protected:
-        std::vector<MonitorEvent> pendingEvents_;
-
+        void post( const MonitorEvent& e );
         void handleAsyncUpdate() override;
+
+        MonitorEvent pendingEvents_[Capacity];
+        std::atomic< uint32_t > head_;      // written by the audio thread
+        std::atomic< uint32_t > tail_;      // written by the message thread
+
+        std::vector< MonitorEvent > queuedEvents_;     // from other threads
+        CriticalSection queueLock_;
     };
 
 
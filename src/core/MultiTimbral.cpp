@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <e3_Exception.h>
+#include "core/Instrument.h"
+#include "core/Polyphony.h"
+#include "core/MultiTimbral.h"
+
+
+namespace e3 {
+
+    MultiTimbral::MultiTimbral()
+    {
+        parts_.reserve( MaxParts );
+    }
+
+
+    MultiTimbral::~MultiTimbral()
+    {
+        clear();
+    }
+
+
+    Part* MultiTimbral::addPart( Instrument* instrument, const MidiZone& zone )
+    {
+        ASSERT( instrument );
+        if (instrument == nullptr || getNumParts() >= MaxParts) {
+            return nullptr;
+        }
+        Part* part = new Part( instrument, zone );
+        parts_.push_back( part );
+        distributeVoices();
+        return part;
+    }
+
+
+    void MultiTimbral::removePart( int index )
+    {
+        ASSERT( index >= 0 && index < getNumParts() );
+        if (index < 0 || index >= getNumParts()) return;
+
+        delete parts_[index];
+        parts_.erase( parts_.begin() + index );
+        distributeVoices();
+    }
+
+
+    void MultiTimbral::clear()
+    {
+        for (size_t i = 0; i < parts_.size(); i++) {
+            delete parts_[i];
+        }
+        parts_.clear();
+    }
+
+
+    // The parts share the arena, so all of them are laid out again together.
+    // The modules let go of it first, the DiskStreamer writes into the rings of a Sampler.
+    //
+    void MultiTimbral::init( double sampleRate )
+    {
+        for (size_t i = 0; i < parts_.size(); i++) {
+            parts_[i]->getInstrument()->resetModules();
+        }
+        arena_.reset();
+        for (size_t i = 0; i < parts_.size(); i++) {
+            parts_[i]->init( sampleRate, &arena_ );
+        }
+        distributeVoices();
+    }
+
+
+    void MultiTimbral::setVoiceBudget( int numVoices )
+    {
+        voiceBudget_ = std::max<int>( 0, numVoices );
+        distributeVoices();
+    }
+
+
+    void MultiTimbral::setMainInstrument( const Instrument* instrument, Polyphony* polyphony )
+    {
+        ASSERT( (instrument == nullptr) == (polyphony == nullptr) );
+
+        mainInstrument_ = instrument;
+        mainPolyphony_  = polyphony;
+        distributeVoices();
+    }
+
+
+    // Every instrument keeps at least one voice. Shares are rounded down, and
+    // the largest ones give up a voice while these minimums exceed the budget.
+    //
+    void MultiTimbral::distributeVoices()
+    {
+        int numParts       = getNumParts();
+        int numInstruments = numParts + (mainInstrument_ != nullptr ? 1 : 0);
+
+        std::vector< int > numVoices( numInstruments );
+        int requested = 0;
+        for (int i = 0; i < numInstruments; i++)
+        {
+            numVoices[i] = (i < numParts) ? parts_[i]->getRequestedVoices() : std::max<int>( 1, mainInstrument_->numVoices_ );
+            requested   += numVoices[i];
+        }
+
+        if (voiceBudget_ > 0 && requested > voiceBudget_)
+        {
+            int sum = 0;
+            for (int i = 0; i < numInstruments; i++)
+            {
+                numVoices[i] = std::max<int>( 1, voiceBudget_ * numVoices[i] / requested );
+                sum         += numVoices[i];
+            }
+            while (sum > voiceBudget_)
+            {
+                std::vector< int >::iterator largest = std::max_element( numVoices.begin(), numVoices.end() );
+                if (*largest <= 1) break;           // more instruments than voices
+                (*largest)--;
+                sum--;
+            }
+        }
+
+        for (int i = 0; i < numParts; i++) {
+            parts_[i]->setMaxVoices( numVoices[i] );
+        }
+        if (mainInstrument_ != nullptr)
+        {
+            mainPolyphony_->setMaxVoices( numVoices[numParts] );
+            mainPolyphony_->setNumUnison( mainInstrument_->numUnison_ );
+        }
+    }
+
+
+    void MultiTimbral::setInput( const AudioSampleBuffer* input )
+    {
+        for (size_t i = 0; i < parts_.size(); i++) {
+            parts_[i]->setInput( input );
+        }
+    }
+
+
+    void MultiTimbral::setTransport( const Transport& transport )
+    {
+        for (size_t i = 0; i < parts_.size(); i++) {
+            parts_[i]->setTransport( transport );
+        }
+    }
+
+
+    void MultiTimbral::handleMidiMessage( const MidiMessage& m )
+    {
+        for (size_t i = 0; i < parts_.size(); i++) {
+            parts_[i]->handleMidiMessage( m );
+        }
+    }
+
+
+    void MultiTimbral::process( AudioSampleBuffer& buffer, int startSample, int numSamples )
+    {
+        for (size_t i = 0; i < parts_.size(); i++) {
+            parts_[i]->process( buffer, startSample, numSamples );
+        }
+    }
+
+} // namespace e3
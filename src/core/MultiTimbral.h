@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include "JuceHeader.h"
+#include "core/Arena.h"
+#include "core/Part.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class MultiTimbral
+    // Instruments that play together in one Processor, each assigned to a
+    // MidiZone. All parts render into the same block on the audio thread, their
+    // outputs are mixed with the gain of each part. The DSP state of all parts
+    // is laid out in one shared arena, and the voice budget is divided between
+    // the parts and the instrument of the Processor in proportion to the voices
+    // each instrument asks for. Parts play their presets as loaded: they have
+    // no MIDI controller map, no parameter queue and no host parameters.
+    //--------------------------------------------------------------------------
+
+    class MultiTimbral
+    {
+    public:
+        enum { MaxParts = 16 };
+
+        MultiTimbral();
+        ~MultiTimbral();
+
+        // Message thread, while processing is suspended.
+        // addPart() takes ownership of the instrument, returns nullptr if there are MaxParts already.
+        Part* addPart( Instrument* instrument, const MidiZone& zone );
+        void removePart( int index );
+        void clear();
+        void init( double sampleRate );
+        void setVoiceBudget( int numVoices );                   // 0: no limit
+
+        // The instrument of the Processor shares the voice budget with the parts,
+        // nullptr if there is none. Call again when its number of voices changes.
+        void setMainInstrument( const Instrument* instrument, Polyphony* polyphony );
+
+        int getNumParts() const                 { return (int)parts_.size(); }
+        Part* getPart( int index ) const        { return parts_[index]; }
+        int getVoiceBudget() const              { return voiceBudget_; }
+        size_t getMemoryUsed() const            { return arena_.getUsed(); }
+
+        // Audio thread
+        void setInput( const AudioSampleBuffer* input );
+        void setTransport( const Transport& transport );
+        void handleMidiMessage( const MidiMessage& m );
+        void process( AudioSampleBuffer& buffer, int startSample, int numSamples );
+
+    protected:
+        void distributeVoices();
+
+        std::vector< Part* > parts_;
+        Arena arena_;
+        int voiceBudget_ = 0;
+        const Instrument* mainInstrument_ = nullptr;
+        Polyphony* mainPolyphony_         = nullptr;
+    };
+
+} // namespace e3
@@ -0,0 +1,197 @@
+
+#include <e3_Exception.h>
+#include "core/Instrument.h"
+#include "core/Module.h"
+#include "core/ControllerMap.h"
+#include "core/ParameterQueue.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // struct ParameterChange
+    //--------------------------------------------------------------------------
+
+    ParameterChange::ParameterChange( const Parameter& parameter, double previousValue, int voice ) :
+        moduleId_( parameter.getModuleId() ),
+        paramId_( parameter.getId() ),
+        voice_( voice ),
+        link_( parameter.isLinkType() ),
+        previousValue_( previousValue ),
+        value_( parameter.value_ )
+    {
+        smooth_ = parameter.controlType_ == ControlSlider || parameter.controlType_ == ControlBiSlider;
+    }
+
+
+    //--------------------------------------------------------------------------
+    // class ParameterQueue
+    //--------------------------------------------------------------------------
+
+    const double ParameterQueue::RampTime = 0.02;
+
+
+    ParameterQueue::ParameterQueue() :
+        head_( 0 ),
+        tail_( 0 )
+    {
+        setSampleRate( INITIAL_SAMPLERATE );
+    }
+
+
+    bool ParameterQueue::push( const ParameterChange& change )
+    {
+        uint32_t head = head_.load( std::memory_order_relaxed );
+        if (head - tail_.load( std::memory_order_acquire ) >= Capacity) {
+            return false;
+        }
+        items_[head & (Capacity - 1)] = change;
+        head_.store( head + 1, std::memory_order_release );
+        return true;
+    }
+
+
+    // Once a change is pending, the following ones queue up behind it, so the
+    // audio thread receives them in order. A pending change of the same parameter
+    // is replaced, the ramp still starts at its previous value.
+    //
+    void ParameterQueue::post( const ParameterChange& change )
+    {
+        if (flush() && push( change ))
+            return;
+
+        for (size_t i = 0; i < pending_.size(); i++)
+        {
+            if (pending_[i].matches( change )) {
+                double previousValue       = pending_[i].previousValue_;
+                pending_[i]                = change;
+                pending_[i].previousValue_ = previousValue;
+                return;
+            }
+        }
+        pending_.push_back( change );
+    }
+
+
+    bool ParameterQueue::flush()
+    {
+        size_t numPushed = 0;
+        while (numPushed < pending_.size() && push( pending_[numPushed] )) {
+            numPushed++;
+        }
+        pending_.erase( pending_.begin(), pending_.begin() + numPushed );
+        return pending_.empty();
+    }
+
+
+    bool ParameterQueue::pop( ParameterChange& change )
+    {
+        uint32_t tail = tail_.load( std::memory_order_relaxed );
+        if (tail == head_.load( std::memory_order_acquire )) {
+            return false;
+        }
+        change = items_[tail & (Capacity - 1)];
+        tail_.store( tail + 1, std::memory_order_release );
+        return true;
+    }
+
+
+    void ParameterQueue::update( Instrument* instrument, ControllerMap* controllers )
+    {
+        ParameterChange change;
+        while (pop( change ))
+        {
+            if (controllers != nullptr) {
+                controllers->onParameterChange( change );
+            }
+            add( instrument, change );
+        }
+    }
+
+
+    void ParameterQueue::add( Instrument* instrument, const ParameterChange& change )
+    {
+        Ramp* ramp = nullptr;
+        for (int i = 0; i < numRamps_; i++)
+        {
+            if (ramps_[i].change.matches( change )) {
+                ramp = &ramps_[i];
+                break;
+            }
+        }
+        if (ramp == nullptr)
+        {
+            if (numRamps_ == MaxRamps) {
+                apply( instrument, change, change.value_ );     // no room, jump
+                return;
+            }
+            ramp          = &ramps_[numRamps_++];
+            ramp->current = change.previousValue_;
+        }
+
+        ramp->change = change;
+        if (change.smooth_ && rampSamples_ > 0)
+        {
+            ramp->remaining = rampSamples_;
+            ramp->increment = (change.value_ - ramp->current) / rampSamples_;
+        }
+        else {
+            ramp->remaining = 0;
+            ramp->increment = 0;
+            ramp->current   = change.value_;
+        }
+    }
+
+
+    void ParameterQueue::advance( Instrument* instrument, int numSamples )
+    {
+        for (int i = 0; i < numRamps_;)
+        {
+            Ramp& ramp = ramps_[i];
+            if (ramp.remaining <= numSamples) {
+                ramp.remaining = 0;
+                ramp.current   = ramp.change.value_;
+            }
+            else {
+                ramp.remaining -= numSamples;
+                ramp.current   += ramp.increment * numSamples;
+            }
+            apply( instrument, ramp.change, ramp.current );
+
+            if (ramp.remaining == 0) {
+                ramp = ramps_[--numRamps_];
+            }
+            else i++;
+        }
+    }
+
+
+    void ParameterQueue::apply( Instrument* instrument, const ParameterChange& change, double value )
+    {
+        Module* module = instrument->getModule( change.moduleId_ );
+        if (module == nullptr) return;      // module has been deleted meanwhile
+
+        if (change.link_) {
+            module->setLinkParameter( change.paramId_, value );
+        }
+        else {
+            module->setParameter( change.paramId_, value, 0, change.voice_ );
+        }
+    }
+
+
+    void ParameterQueue::setSampleRate( double sampleRate )
+    {
+        rampSamples_ = (int)(sampleRate * RampTime);
+    }
+
+
+    void ParameterQueue::clear()
+    {
+        ParameterChange change;
+        while (pop( change ));
+        pending_.clear();
+        numRamps_ = 0;
+    }
+
+} // namespace e3
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include "core/Parameter.h"
+
+
+namespace e3 {
+
+    class Instrument;
+    class ControllerMap;
+
+    //--------------------------------------------------------------------------
+    // struct ParameterChange
+    // A parameter value on its way from the message thread to the audio thread.
+    //--------------------------------------------------------------------------
+
+    struct ParameterChange
+    {
+        ParameterChange() {}
+        ParameterChange( const Parameter& parameter, double previousValue, int voice = -1 );
+
+        bool matches( const ParameterChange& other ) const
+        {
+            return other.moduleId_ == moduleId_ && other.paramId_ == paramId_ &&
+                   other.voice_ == voice_ && other.link_ == link_;
+        }
+
+        int moduleId_         = -1;
+        int paramId_          = -1;     // link id for link parameters
+        int voice_            = -1;     // -1: all voices
+        bool link_            = false;
+        bool smooth_          = false;  // sliders are ramped, checkboxes and number edits jump
+        double previousValue_ = 0;
+        double value_         = 0;
+    };
+
+
+    //--------------------------------------------------------------------------
+    // class ParameterQueue
+    // Lock-free transport of parameter changes to the audio thread.
+    // push() and post() are called from the message thread only, update() and
+    // advance() from the audio thread only (single producer, single consumer).
+    // The audio thread drains the queue once per block, merges all changes of
+    // the same parameter and ramps continuous values over RampTime, so the
+    // derived values of a module are recomputed once per control block instead
+    // of once per slider tick.
+    //--------------------------------------------------------------------------
+
+    class ParameterQueue
+    {
+    public:
+        enum {
+            Capacity         = 1024,    // must be a power of two
+            MaxRamps         = 64,
+            ControlBlockSize = 64       // samples between two ramp steps
+        };
+        static const double RampTime;   // seconds
+
+        ParameterQueue();
+
+        // Message thread. push() returns false if the queue is full.
+        // post() keeps a change that does not fit, only the latest one of each
+        // parameter, until flush() gets it into the queue. flush() returns true
+        // when nothing is pending anymore.
+        bool push( const ParameterChange& change );
+        void post( const ParameterChange& change );
+        bool flush();
+        bool hasPending() const                 { return pending_.empty() == false; }
+
+        // Audio thread.
+        // update() drains the queue and tells controllers about the new values, for soft takeover.
+        // add() starts or retargets the ramp for a change that originates on the audio thread.
+        bool pop( ParameterChange& change );
+        void update( Instrument* instrument, ControllerMap* controllers = nullptr );
+        void add( Instrument* instrument, const ParameterChange& change );
+        void advance( Instrument* instrument, int numSamples );
+        bool isRamping() const                  { return numRamps_ > 0; }
+
+        void setSampleRate( double sampleRate );
+
+        // Drops all queued and pending changes and ramps. Call only while processing is suspended.
+        void clear();
+
+    protected:
+        struct Ramp
+        {
+            ParameterChange change;
+            double current;
+            double increment;
+            int remaining;              // samples
+        };
+
+        void apply( Instrument* instrument, const ParameterChange& change, double value );
+
+        std::vector< ParameterChange > pending_;    // message thread only
+        ParameterChange items_[Capacity];
+        std::atomic< uint32_t > head_;  // written by the producer
+        std::atomic< uint32_t > tail_;  // written by the consumer
+
+        Ramp ramps_[MaxRamps];
+        int numRamps_    = 0;
+        int rampSamples_ = 0;
+    };
+
+} // namespace e3
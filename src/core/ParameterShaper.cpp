@@ -2,6 +2,7 @@
 
 
 #include <math.h>
+#include <algorithm>
 #include <e3_Exception.h>
 #include <e3_Math.h>
 
@@ -57,46 +58,21 @@ namespace e3 {
 
 
     //--------------------------------------------------------------------------------------
-    // class MidiParameterValue
+    // class MidiParameterShaper
     //--------------------------------------------------------------------------------------
-    /*
-    bool MidiParameterValue::scaleController(int16_t controllerId, double& value)
-    {
-        if (controller_ == -1 || controller != controller_)
-            return false;
-
-        value = normalize(value, controllerMin_, controllerMax_);
-        //if (controllerMax_ < controllerMin_)                   // reverse range if min > max
-        //    value = controllerMin_ - value;
-
-        //FLOAT range = abs(controllerMax_ - controllerMin_);
-        //value /= range;                                         // normalize to 1
 
-        if (max_ < min_)
-            value = min_ - value;
-
-        range = abs(max_ - min_);
-        FLOAT raster = range / numSteps_;
-        value *= range;
-        value = makeLogarithmic(value);                // apply logarithmic scaling factor
-
-        if (numSteps_ > 0) {                                   // rasterize
-            value = (INT16)(value / raster) * raster;
-        }
-
-        if (controllerSoft_ && controllerAccepted_ == false)   // soft takeover
-        {
-            FLOAT diff = abs(value_ - value);
-            if (diff > raster * 2) {
-                return false;
-            }
-            controllerAccepted_ = true;
+    double MidiParameterShaper::scaleController(double controllerValue, const ParameterShaper& target) const
+    {
+        double range = controllerMax_ - controllerMin_;         // reversed if max < min
+        double v     = (range != 0) ? (controllerValue - controllerMin_) / range : 0;
+        v            = std::max<double>( 0, std::min<double>( 1, v ) );
+
+        v = target.getMin() + v * target.getRange();
+        if (target.getNumSteps() > 0) {
+            double interval = target.getInterval();
+            v = target.getMin() + floor( (v - target.getMin()) / interval + 0.5 ) * interval;
         }
-        return true;
+        return v;
     }
-    */
-    
-
-
 
-} // namespace e3;
\ No newline at end of file
+} // namespace e3;
@@ -69,27 +69,35 @@ namespace e3 {
             softTakeover_(softTakeover)
         {}
 
-        int16_t getControllerId() const { return controllerId_; }
-        double getControllerMin() const { return controllerMin_; }
-        double getControllerMax() const { return controllerMax_; }
-        bool getSoftTakeover() const    { return softTakeover_; }
-
-        void setControllerId(int16_t id)  { controllerId_ = id; }
-        void setControllerMin(double min) { controllerMin_ = min; }
-        void setControllerMax(double max) { controllerMax_ = max; }
-        void setSoftTakeover(bool soft)   { softTakeover_ = soft; }
-
-        //MidiParameterShaper() : ParameterShaper() {}
-        //MidiParameterShaper(const ParameterShaper& other) : ParameterShaper(other) {}
+        // Controller ids: 0-127 plain controllers, 128-159 14-bit controller pairs (MSB 0-31, LSB 32-63),
+        // 256 + n for NRPN number n.
+        enum {
+            Controller14Bit = 128,
+            ControllerNrpn  = 256
+        };
+
+        int16_t getControllerId() const      { return controllerId_; }
+        int16_t getControllerChannel() const { return controllerChannel_; }
+        double getControllerMin() const      { return controllerMin_; }
+        double getControllerMax() const      { return controllerMax_; }
+        bool getSoftTakeover() const         { return softTakeover_; }
+
+        void setControllerId(int16_t id)            { controllerId_ = id; }
+        void setControllerChannel(int16_t channel)  { controllerChannel_ = channel; }
+        void setControllerMin(double min)           { controllerMin_ = min; }
+        void setControllerMax(double max)           { controllerMax_ = max; }
+        void setSoftTakeover(bool soft)             { softTakeover_ = soft; }
+
+        // Maps a controller value (0-127, fractional for 14-bit controllers) 
+        // into the range of target, quantized to its steps.
+        double scaleController(double controllerValue, const ParameterShaper& target) const;
+
     protected:
         int16_t controllerId_;
+        int16_t controllerChannel_ = -1;    // -1: all channels, 0-15
         double controllerMin_;
         double controllerMax_;
         bool softTakeover_;
-
-    private:
-        bool controllerAccepted_ = false;
-
     };
 
 } // namespace e3
\ No newline at end of file
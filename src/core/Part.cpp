@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <e3_Exception.h>
+#include "core/Instrument.h"
+#include "core/Polyphony.h"
+#include "core/Sink.h"
+#include "core/ModulationMatrix.h"
+#include "core/Part.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // struct MidiZone
+    //--------------------------------------------------------------------------
+
+    bool MidiZone::accepts( const MidiMessage& m ) const
+    {
+        int channel = m.getChannel();       // 0: system message, for all zones
+        if (channel > 0 && (channel < firstChannel || channel > lastChannel)) {
+            return false;
+        }
+        if (m.isNoteOn() || m.isNoteOff() || m.isAftertouch())
+        {
+            int key = m.getNoteNumber();
+            return key >= lowKey && key <= highKey;
+        }
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------
+    // class Part
+    //--------------------------------------------------------------------------
+
+    Part::Part( Instrument* instrument, const MidiZone& zone ) :
+        instrument_( instrument ),
+        polyphony_( new Polyphony() ),
+        sink_( new Sink() ),
+        modulationMatrix_( new ModulationMatrix() ),
+        zone_( zone )
+    {
+        ASSERT( instrument );
+        setupPolyphony( polyphony_, instrument_ );
+    }
+
+
+    Part::~Part()
+    {}
+
+
+    void Part::setupPolyphony( Polyphony* polyphony, const Instrument* instrument )
+    {
+        polyphony->setNumVoices( instrument->numVoices_ );
+        polyphony->setNumUnison( instrument->numUnison_ );
+        polyphony->setUnisonSpread( instrument->unisonSpread_ );
+        polyphony->setHold( instrument->hold_ );
+        polyphony->setRetrigger( instrument->retrigger_ );
+        polyphony->setLegato( instrument->legato_ );
+        polyphony->setMpe( instrument->mpe_ );
+        polyphony->setStealPolicy( (Polyphony::StealPolicy)instrument->stealPolicy_ );
+    }
+
+
+    void Part::init( double sampleRate, Arena* arena )
+    {
+        sink_->setSampleRate( sampleRate );
+        polyphony_->setSampleRate( sampleRate );
+        polyphony_->allNotesOff( true );
+
+        sink_->sort( instrument_ );
+        instrument_->initModules( sampleRate, polyphony_->getNumVoices(), polyphony_, sink_, arena );
+        instrument_->loadPreset();
+        instrument_->connectModules();
+        instrument_->updateModules();
+
+        sink_->fuse( instrument_ );
+        sink_->setGain( gain_ );
+        modulationMatrix_->compile( instrument_, polyphony_->getNumVoices() );
+        polyphony_->setVoiceLevels( sink_->getOutputLevels() );
+    }
+
+
+    void Part::setMaxVoices( int maxVoices )
+    {
+        polyphony_->setMaxVoices( maxVoices );
+        polyphony_->setNumUnison( instrument_->numUnison_ );
+    }
+
+
+    int Part::getRequestedVoices() const
+    {
+        return std::max<int>( 1, instrument_->numVoices_ );
+    }
+
+
+    void Part::setGain( double gain )
+    {
+        gain_ = gain;
+        sink_->setGain( gain );
+    }
+
+
+    void Part::handleMidiMessage( const MidiMessage& m )
+    {
+        if (zone_.accepts( m ) == false) return;
+
+        polyphony_->handleMidiMessage( m );
+        modulationMatrix_->processVoiceEvents( polyphony_->getVoiceEvents() );
+        sink_->processVoiceEvents( polyphony_ );
+    }
+
+
+    void Part::setInput( const AudioSampleBuffer* input )
+    {
+        sink_->setInput( input );
+    }
+
+
+    void Part::setTransport( const Transport& transport )
+    {
+        polyphony_->transport_ = transport;
+    }
+
+
+    void Part::process( AudioSampleBuffer& buffer, int startSample, int numSamples )
+    {
+        modulationMatrix_->update();
+        sink_->process( buffer, startSample, numSamples );
+        polyphony_->advance( numSamples );
+    }
+
+} // namespace e3
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include "core/Transport.h"
+
+
+namespace e3 {
+
+    class Instrument;
+    class Polyphony;
+    class Sink;
+    class ModulationMatrix;
+    class Arena;
+
+    //--------------------------------------------------------------------------
+    // struct MidiZone
+    // The MIDI channels and keys an instrument responds to.
+    //--------------------------------------------------------------------------
+
+    struct MidiZone
+    {
+        MidiZone() {}
+        MidiZone( int first, int last, int low = 0, int high = 127 ) :
+            firstChannel( first ), lastChannel( last ), lowKey( low ), highKey( high )
+        {}
+
+        bool accepts( const MidiMessage& m ) const;
+        bool isComplete() const     { return firstChannel <= 1 && lastChannel >= 16 && lowKey <= 0 && highKey >= 127; }
+
+        int firstChannel = 1;       // 1-16
+        int lastChannel  = 16;
+        int lowKey       = 0;
+        int highKey      = 127;
+    };
+
+
+    //--------------------------------------------------------------------------
+    // class Part
+    // An instrument of the multi-timbral layer, with its own voices, processing
+    // order and modulation, played by the messages of its MidiZone.
+    // The part owns the instrument. Its output is added to the block with the
+    // gain of the part.
+    //--------------------------------------------------------------------------
+
+    class Part
+    {
+    public:
+        Part( Instrument* instrument, const MidiZone& zone = MidiZone() );
+        ~Part();
+
+        // Applies the voicing attributes of the instrument, see Processor::setInstrument()
+        static void setupPolyphony( Polyphony* polyphony, const Instrument* instrument );
+
+        // Message thread, while processing is suspended.
+        // With an arena, the part's state is laid out behind the parts initialized before.
+        void init( double sampleRate, Arena* arena = nullptr );
+        void setMaxVoices( int maxVoices );
+        int getRequestedVoices() const;
+
+        void setZone( const MidiZone& zone )        { zone_ = zone; }
+        const MidiZone& getZone() const             { return zone_; }
+        void setGain( double gain );
+        double getGain() const                      { return gain_; }
+        void setInput( const AudioSampleBuffer* input );
+        void setTransport( const Transport& transport );
+
+        // Audio thread
+        void handleMidiMessage( const MidiMessage& m );
+        void process( AudioSampleBuffer& buffer, int startSample, int numSamples );
+
+        Instrument* getInstrument() const           { return instrument_; }
+        Polyphony* getPolyphony() const             { return polyphony_; }
+
+    protected:
+        ScopedPointer<Instrument> instrument_;
+        ScopedPointer<Polyphony> polyphony_;
+        ScopedPointer<Sink> sink_;
+        ScopedPointer<ModulationMatrix> modulationMatrix_;
+        MidiZone zone_;
+        double gain_ = 1;
+    };
+
+} // namespace e3
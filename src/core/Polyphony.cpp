@@ -1,6 +1,7 @@
 
-#include <e3_Trace.h>
+#include <algorithm>
 #include "core/GlobalHeader.h"
+#include "core/AudioTrace.h"
 #include "core/Polyphony.h"
 
 
@@ -9,24 +10,24 @@ namespace e3 {
 	Polyphony::Polyphony()
 	{
 		setNumVoices( 1 );
-		stack_.reserve( 100 );
+		stack_.reserve( MaxNotes );
 		monitorVoiceEvent( 0 );
 	}
 
 
 	void Polyphony::handleMidiMessage( const MidiMessage& m )
 	{
-		const uint8_t* data = m.getRawData();
-		TRACE( "Midi Message: [0]: %3d   [1]: %3d   [2]: %3d \n", data[0], data[1], data[2] );
-		//TRACE("Midi Message: [0]: %2x [1]: %2x [2]: %2x \n", data[0], data[1], data[2]);
+		AUDIO_TRACE( AudioTraceEvent, TraceMidiMessage, m.getRawData()[0], m.getRawData()[1] << 8 | m.getRawData()[2] );
+
+		int channel = m.getChannel();
 
 		if( m.isNoteOn() )
 		{
-			noteOn( m.getNoteNumber(), m.getFloatVelocity() );
+			noteOn( m.getNoteNumber(), m.getFloatVelocity(), channel );
 		}
 		else if( m.isNoteOff() )
 		{
-			noteOff( m.getNoteNumber() );
+			noteOff( m.getNoteNumber(), channel );
 		}
 		else if( m.isAllNotesOff() || m.isAllSoundOff() )
 		{
@@ -34,25 +35,111 @@ namespace e3 {
 		}
 		else if( m.isPitchWheel() )
 		{
-			int value = m.getPitchWheelValue();
-			midiPitchbendSignal( value );
-			monitorPitchbendEvent( value );
+			VoiceEvent e;
+			e.type_ = VoiceEvent::Pitchbend;
+			e.bend_ = m.getPitchWheelValue();
+
+			if( isMemberChannel( channel ) ) {           // per note pitchbend
+				channels_[channel].bend = e.bend_;
+				addVoiceEvents( e, channel );
+			}
+			else {
+				events_.push_back( e );
+				monitorPitchbendEvent( e.bend_ );
+			}
+		}
+		else if( m.isChannelPressure() )
+		{
+			VoiceEvent e;
+			e.type_  = VoiceEvent::Pressure;
+			e.value_ = m.getChannelPressureValue() / 127.;
+
+			if( isMemberChannel( channel ) ) {
+				channels_[channel].pressure = e.value_;
+				addVoiceEvents( e, channel );
+			}
+			else {
+				events_.push_back( e );
+			}
 		}
-		else if( m.isAftertouch() )
+		else if( m.isAftertouch() )                          // polyphonic key pressure
 		{
-			midiAftertouchSignal( m.getNoteNumber(), m.getAfterTouchValue() );
+			VoiceEvent e;
+			e.type_  = VoiceEvent::Pressure;
+			e.value_ = m.getAfterTouchValue() / 127.;
+			addVoiceEvents( e, channel, m.getNoteNumber() + tuning_ );
 		}
 		else if( m.isController() )
 		{
 			int number = m.getControllerNumber();
 			int value = m.getControllerValue();
-			midiControllerSignal( number, value );
+
+			if( number == TimbreController && isMemberChannel( channel ) )
+			{
+				VoiceEvent e;
+				e.type_  = VoiceEvent::Timbre;
+				e.value_ = value / 127.;
+				channels_[channel].timbre = e.value_;
+				addVoiceEvents( e, channel );
+			}
 			monitorControllerEvent( number, value );
 		}
 	}
 
 
-	void Polyphony::noteOn( double pitch, double gate )
+	// Adds a copy of e for each sounding voice of the note with the given pitch,
+	// or of all notes on channel if pitch is -1. Channels are only told apart in MPE mode.
+	void Polyphony::addVoiceEvents( VoiceEvent e, int channel, double pitch )
+	{
+		int unisonGroup = -1;
+		if( pitch > -1 )
+		{
+			for( int i = stack_.size() - 1; i >= 0; i-- )
+			{
+				if( stack_[i].pitch_ == pitch && ( mpe_ == false || stack_[i].channel_ == channel ) ) {
+					unisonGroup = stack_[i].unisonGroup_;
+					break;
+				}
+			}
+			if( unisonGroup == -1 ) {
+				return;
+			}
+		}
+
+		for( int i = 0; i < numVoices_; i++ )
+		{
+			const Voice& v = voices_[i];
+			if( v.state_ == Voice::Silent || v.state_ == Voice::Fading ) continue;
+			if( unisonGroup > -1 ? v.unisonGroup_ != unisonGroup : v.channel_ != channel ) continue;
+
+			e.voice_ = i;
+			events_.push_back( e );
+		}
+	}
+
+
+	// A new note on an MPE member channel starts with the values the channel had before.
+	void Polyphony::addChannelState( int channel, int voice )
+	{
+		const ChannelState& state = channels_[channel];
+		VoiceEvent e;
+		e.voice_ = voice;
+
+		e.type_ = VoiceEvent::Pitchbend;
+		e.bend_ = state.bend;
+		events_.push_back( e );
+
+		e.type_  = VoiceEvent::Pressure;
+		e.value_ = state.pressure;
+		events_.push_back( e );
+
+		e.type_  = VoiceEvent::Timbre;
+		e.value_ = state.timbre;
+		events_.push_back( e );
+	}
+
+
+	void Polyphony::noteOn( double pitch, double gate, int channel )
 	{
 		monitorNoteEvent( pitch, gate );
 
@@ -67,16 +154,25 @@ namespace e3 {
 
 		for( int i = 0; i < numUnison_; i++ )   // trigger unison voices
 		{
-			int voice = getUnusedVoice();
+			double unisonPitch = basePitch + i * unisonSpread_;
+			int voice = getUnusedVoice( unisonPitch );
 			if( voice >= 0 )
 			{
-				double unisonPitch = basePitch + i * unisonSpread_;
 				Voice* current = &voices_[voice];
 				current->unisonGroup_ = unisonGroup;
 				current->pitch_ = unisonPitch;
+				current->channel_ = channel;
+				current->pan_ = ( numUnison_ > 1 ) ? 2.0 * i / ( numUnison_ - 1 ) - 1 : 0;   // spread from left to right
 
 				if( i == 0 ) {  // put the played note on the stack
+					if( stack_.size() == stack_.capacity() ) {          // no allocation on the audio thread, forget the oldest note
+						stack_.erase( stack_.begin() );
+					}
 					stack_.push_back( Voice( voice, Voice::NoteOn, unisonPitch, gate, tags_, unisonGroup ) );
+					stack_.back().channel_ = channel;
+				}
+				if( isMemberChannel( channel ) ) {
+					addChannelState( channel, voice );
 				}
 				startVoice( voice, unisonPitch, gate );
 			}
@@ -86,7 +182,7 @@ namespace e3 {
 	}
 
 
-	void Polyphony::noteOff( double pitch )
+	void Polyphony::noteOff( double pitch, int channel )
 	{
 		double basePitch = pitch + tuning_;
 
@@ -95,7 +191,7 @@ namespace e3 {
 
 		for( idxStack = stack_.size() - 1; idxStack >= 0; idxStack-- )    // find voice
 		{
-			if( stack_[idxStack].pitch_ == basePitch ) {
+			if( stack_[idxStack].pitch_ == basePitch && ( mpe_ == false || stack_[idxStack].channel_ == channel ) ) {
 				offVoice = &stack_[idxStack];
 				break;
 			}
@@ -119,7 +215,7 @@ namespace e3 {
 		for( int i = 0; i < numVoices_; i++ )                       // set state to NoteOff for the voice and all assigned unisonVoices
 		{
 			Voice* next = &voices_[i];
-			if( next->unisonGroup_ == offVoice->unisonGroup_ && next->state_ > Voice::Silent )
+			if( next->unisonGroup_ == offVoice->unisonGroup_ && next->state_ > Voice::Silent && next->state_ != Voice::Fading )
 			{
 				next->state_ &= ~Voice::NoteOn;
 				next->state_ |= Voice::NoteOff;
@@ -127,8 +223,7 @@ namespace e3 {
 				ASSERT( numActive_ >= 0 );
 
 				if( !hold_ && !sustain_ || ( hold_ && retrigger_ && !sustain_ && numActive_ >= numUnison_ ) )  {
-					midiGateSignal( 0, next->id_ );
-					midiNoteSignal( next->pitch_, 0, next->id_ );
+					addNoteEvent( next->pitch_, 0, next->id_ );
 				}
 			}
 		}
@@ -141,9 +236,7 @@ namespace e3 {
 		int state = Voice::NoteOn | ( hold_ ? Voice::NoteHold : 0 );
 		voices_[voice].init( voice, state, pitch, gate, tags_ );
 
-		midiPitchSignal( pitch, voice );
-		midiGateSignal( gate, voice );
-		midiNoteSignal( pitch, gate, voice );
+		addNoteEvent( pitch, gate, voice );
 
 		tags_++;
 		numSounding_++;
@@ -154,11 +247,29 @@ namespace e3 {
 	}
 
 
+	void Polyphony::addNoteEvent( double pitch, double gate, int voice, bool gateChanged )
+	{
+		VoiceEvent e;
+		e.type_        = VoiceEvent::Note;
+		e.voice_       = voice;
+		e.pitch_       = pitch;
+		e.gate_        = gate;
+		e.gateChanged_ = gateChanged;
+		events_.push_back( e );
+	}
+
+
 	void Polyphony::endVoice( int voice )
 	{
 		Voice& v = voices_[voice];
 		if( v.state_ )
 		{
+			if( v.state_ == Voice::Fading ) {
+				numFading_--;
+			}
+			if( v.state_ & Voice::NoteOn ) {                 // cut while playing
+				numActive_--;
+			}
 			numSounding_--;
 			monitorVoiceEvent( numSounding_ );
 
@@ -179,16 +290,19 @@ namespace e3 {
 			if( reset ) {
 				next->reset();
 			}
-			else if( next->state_ > Voice::Silent )
+			else if( next->state_ > Voice::Silent && next->state_ != Voice::Fading )
 			{
 				next->state_ = Voice::NoteOff;
-				midiGateSignal( 0, next->id_ );
-				midiNoteSignal( next->pitch_, 0, next->id_ );
+				addNoteEvent( next->pitch_, 0, next->id_ );
 			}
 		}
 		stack_.clear();
 
-		if( reset ) numSounding_ = 0;
+		if( reset ) {
+			numSounding_ = 0;
+			numFading_ = 0;
+			events_.clear();
+		}
 		numActive_ = 0;
 
 		updateSoundingVoices();
@@ -196,18 +310,97 @@ namespace e3 {
 	}
 
 
-	void Polyphony::setNumVoices( int numVoices )
+	// The modules allocate their state for getNumVoices(), which includes the reserve voices.
+	// Without a capacity, the next power of two is reserved.
+	void Polyphony::setNumVoices( int numVoices, int capacity )
 	{
+		if( capacity <= 0 )
+		{
+			capacity = MinVoiceCapacity;
+			while( capacity < numVoices ) capacity *= 2;
+		}
+		capacity_   = std::max<int>( numVoices, capacity );
+		numVoices_  = capacity_ + std::min<int>( capacity_, MaxReserveVoices );
+		maxVoices_  = numVoices;
+		voiceLimit_ = numVoices;
+
 		stack_.clear();
 		voices_.clear();
-		voices_.resize( numVoices );
+		voices_.resize( numVoices_ );
+		fadeCounters_.assign( numVoices_, 0 );
 
-		numVoices_ = numVoices;
 		numSounding_ = 0;
 		numActive_ = 0;
+		numFading_ = 0;
+		levels_ = nullptr;
 
-		soundingVoices_.resize( numVoices );
+		soundingVoices_.resize( numVoices_ );
 		updateSoundingVoices();
+
+		events_.reserve( 6 * numVoices_ + 16 );     // enough for any single message, no allocation on the audio thread
+	}
+
+
+	// Changes the number of playable voices without reallocation. Voices above the
+	// new limit play on, until new notes steal them.
+	void Polyphony::setMaxVoices( int maxVoices )
+	{
+		voiceLimit_ = std::max<int>( 1, std::min<int>( capacity_, maxVoices ) );
+		maxVoices_  = voiceLimit_;
+		numUnison_  = std::min<int>( maxVoices_, numUnison_ );
+	}
+
+
+	void Polyphony::setAdaptive( bool adaptive )
+	{
+		adaptive_  = adaptive;
+		maxVoices_ = voiceLimit_;
+	}
+
+
+	// Drops a quarter of the voices when the load is high, and adds them back one
+	// by one when it is low again. Returns true if the number of voices changed.
+	bool Polyphony::adaptToCpuLoad( double percent )
+	{
+		if( adaptive_ == false ) return false;
+
+		int maxVoices = maxVoices_;
+		if( percent > CpuHighLoad ) {
+			maxVoices = std::max<int>( numUnison_, maxVoices_ - std::max<int>( 1, maxVoices_ / 4 ) );
+		}
+		else if( percent < CpuLowLoad ) {
+			maxVoices = std::min<int>( voiceLimit_, maxVoices_ + 1 );
+		}
+		if( maxVoices == maxVoices_ ) return false;
+
+		AUDIO_TRACE( AudioTraceEvent, TraceVoiceLimit, percent, maxVoices );
+		maxVoices_ = maxVoices;
+		return true;
+	}
+
+
+	void Polyphony::setSampleRate( double sampleRate )
+	{
+		fadeSamples_ = std::max<int>( 1, (int)( sampleRate * FadeTime / 1000 ) );
+	}
+
+
+	// Ends the stolen voices whose fade is over. Usually the output envelope has
+	// ended them already, this is for instruments without one.
+	void Polyphony::advance( int numSamples )
+	{
+		if( numFading_ == 0 ) return;
+
+		for( int i = 0; i < numVoices_; i++ )
+		{
+			if( voices_[i].state_ == Voice::Fading )
+			{
+				fadeCounters_[i] -= numSamples;
+				if( fadeCounters_[i] <= 0 ) {
+					endVoice( i );
+				}
+			}
+		}
 	}
 
 
@@ -224,14 +417,14 @@ namespace e3 {
 				for( int j = 0; j < numVoices_ && counter < numUnison_; j++ )    // iterate over unison voices
 				{
 					Voice* next = &voices_[j];
-					if( next->unisonGroup_ == first->unisonGroup_ && next->state_ > Voice::Silent )
+					if( next->unisonGroup_ == first->unisonGroup_ && next->state_ > Voice::Silent && next->state_ != Voice::Fading )
 					{
 						double pitch = basePitch + counter * unisonSpread_;
 
 						if( next->pitch_ != pitch )
 						{
 							next->pitch_ = pitch;
-							midiNoteSignal( pitch, gate, j );
+							addNoteEvent( pitch, gate, j, false );
 						}
 						counter++;
 					}
@@ -254,33 +447,112 @@ namespace e3 {
 	}
 
 
-	int Polyphony::getUnusedVoice()
+	// Returns a silent voice while less than maxVoices_ are playing. Otherwise a
+	// voice is stolen and fades out, and the new note gets a reserve voice.
+	// The stolen voice is cut at once only if all reserve voices are still fading.
+	int Polyphony::getUnusedVoice( double pitch )
 	{
-		int idxKill = -1;
+		int voice = getSilentVoice();
+
+		if( numSounding_ - numFading_ < maxVoices_ )
+		{
+			if( voice >= 0 ) {
+				return voice;
+			}
+			int idxKill = -1;                                   // all free voices are fading, cut the oldest
+			for( int i = 0; i < numVoices_; i++ )
+			{
+				if( voices_[i].state_ == Voice::Fading && ( idxKill == -1 || fadeCounters_[i] < fadeCounters_[idxKill] ) ) {
+					idxKill = i;
+				}
+			}
+			if( idxKill >= 0 ) {
+				endVoice( idxKill );
+			}
+			return idxKill;
+		}
+
+		int idxKill = findVictim( pitch );
+		if( idxKill >= 0 )
+		{
+			AUDIO_TRACE( AudioTraceVerbose, TraceVoiceSteal, idxKill, pitch );
+			if( voice >= 0 ) {
+				fadeVoice( idxKill );
+				return voice;
+			}
+			endVoice( idxKill );
+		}
+		return idxKill;
+	}
 
+
+	int Polyphony::getSilentVoice() const
+	{
 		for( int i = 0; i < numVoices_; i++ )
 		{
-			if( voices_[i].state_ == Voice::Silent ) {         // voices available?
+			if( voices_[i].state_ == Voice::Silent ) {
 				return i;
 			}
 		}
+		return -1;
+	}
+
+
+	// The playing voice with the lowest rank, the oldest one if ranks are equal.
+	int Polyphony::findVictim( double pitch ) const
+	{
+		int idxKill = -1;
+		double minRank = 0;
 
-		for( int i = 0; i < numVoices_; i++ )		       // all voices sounding, so interrupt oldest.
+		for( int i = 0; i < numVoices_; i++ )
 		{
-			if( idxKill == -1 ) {
-				idxKill = i;
-			}
-			else if( voices_[i].tag_ < voices_[idxKill].tag_ ) {
+			const Voice& v = voices_[i];
+			if( v.state_ == Voice::Silent || v.state_ == Voice::Fading ) continue;
+
+			double rank = getStealRank( v, pitch );
+			if( idxKill == -1 || rank < minRank || ( rank == minRank && v.tag_ < voices_[idxKill].tag_ ) )
+			{
 				idxKill = i;
+				minRank = rank;
 			}
 		}
-		if( idxKill >= 0 ) {
-			endVoice( idxKill );
-		}
 		return idxKill;
 	}
 
 
+	double Polyphony::getStealRank( const Voice& voice, double pitch ) const
+	{
+		switch( stealPolicy_ )
+		{
+		case StealQuietest:
+			return levels_ != nullptr ? levels_[voice.id_] : 0;
+		case StealSamePitch:
+			return voice.pitch_ == pitch ? 0 : 1;
+		case StealLowestPriority:
+			return ( ( voice.state_ & ( Voice::NoteOn | Voice::NoteHold ) ) ? 2 : 0 ) + voice.gate_;
+		default:
+			return 0;
+		}
+	}
+
+
+	void Polyphony::fadeVoice( int voice )
+	{
+		Voice& v = voices_[voice];
+		if( v.state_ & Voice::NoteOn ) {
+			numActive_--;
+		}
+		v.state_ = Voice::Fading;
+		fadeCounters_[voice] = fadeSamples_;
+		numFading_++;
+
+		VoiceEvent e;
+		e.type_  = VoiceEvent::Fade;
+		e.voice_ = voice;
+		events_.push_back( e );
+	}
+
+
 	double Polyphony::getPreviousPitch( int voice )
 	{
 		if( lastPitch_ >= 0 && voice >= 0 && voice < (int)voices_.size() )
@@ -297,7 +569,7 @@ namespace e3 {
 
 	void Polyphony::setNumUnison( int numUnison )
 	{
-		numUnison_ = std::min<int>( numVoices_, numUnison );
+		numUnison_ = std::min<int>( voiceLimit_, numUnison );
 	}
 
 
@@ -325,8 +597,7 @@ namespace e3 {
 				Voice* next = &voices_[i];
 				if( next->state_ == Voice::NoteOff )
 				{
-					midiGateSignal( 0, next->id_ );
-					midiNoteSignal( next->pitch_, 0, next->id_ );
+					addNoteEvent( next->pitch_, 0, next->id_ );
 				}
 			}
 		}
@@ -339,4 +610,13 @@ namespace e3 {
 	}
 
 
+	void Polyphony::setMpe( bool mpe )
+	{
+		mpe_ = mpe;
+		for( int i = 0; i < 17; i++ ) {
+			channels_[i] = ChannelState();
+		}
+	}
+
+
 } // namespace e3
\ No newline at end of file
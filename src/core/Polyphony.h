@@ -7,6 +7,7 @@
 #include "core/GlobalHeader.h"
 #include <e3_Buffer.h>
 #include "core/Voice.h"
+#include "core/Transport.h"
 #include "core/MonitorUpdater.h"
 
 
@@ -15,12 +16,40 @@ namespace e3 {
     //----------------------------------------------------------------------------------
     // class Polyphony
     // Polyphonic voice managment
+    // In MPE mode (lower zone) channel 1 is the master channel, notes on the member
+    // channels 2-16 get their own pitchbend, pressure and timbre (controller 74).
+    // When all voices are playing, a new note steals one, chosen by the StealPolicy.
+    // The stolen voice fades out for FadeTime msec while the new note starts on
+    // one of the reserve voices, which are allocated on top of the playable voices.
+    // The voices are allocated for a capacity, the number of playable voices can
+    // change up to the capacity without reallocation. In adaptive mode the number
+    // follows the cpu load, but never exceeds the number the user has set.
     //----------------------------------------------------------------------------------
     class Polyphony : public MonitorUpdater
     {
 		friend class Processor;
+		friend class Part;
 
     public:
+        enum {
+            MpeMasterChannel = 1,
+            TimbreController = 74,
+            MaxReserveVoices = 4,
+            MaxNotes         = 128,     // notes on the stack
+            MinVoiceCapacity = 16,
+            FadeTime         = 5,       // msec
+            CpuHighLoad      = 80,      // percent, adaptive mode drops voices above
+            CpuLowLoad       = 50       // and adds them again below
+        };
+
+        enum StealPolicy {
+            StealOldest         = 0,
+            StealQuietest       = 1,    // lowest level of the output envelope
+            StealSamePitch      = 2,    // a voice playing the same pitch, else the oldest
+            StealLowestPriority = 3,    // released before held voices, soft before loud ones
+            NumStealPolicies
+        };
+
         Polyphony();
         ~Polyphony() {}
 
@@ -29,9 +58,23 @@ namespace e3 {
         void startVoice( int voice, double pitch, double gate );
         void endVoice( int voice );
 
-        void setNumVoices( int numVoices );
-        int getNumVoices() const                    { return numVoices_; }
+        void setNumVoices( int numVoices, int capacity = 0 );
+        void setMaxVoices( int maxVoices );
+        int getNumVoices() const                    { return numVoices_; }     // including the reserve voices
+        int getMaxVoices() const                    { return maxVoices_; }     // voices that play at the same time
+        int getCapacity() const                     { return capacity_; }      // maximum for setMaxVoices()
+        void setAdaptive( bool adaptive );
+        bool getAdaptive() const                    { return adaptive_; }
+        bool adaptToCpuLoad( double percent );
         bool isVoiceActive( int voice ) const	    { return voices_[voice].state_ != Voice::Silent; }
+        bool isVoiceFading( int voice ) const	    { return voices_[voice].state_ == Voice::Fading; }
+
+        void setStealPolicy( StealPolicy policy )   { stealPolicy_ = policy; }
+        StealPolicy getStealPolicy() const          { return stealPolicy_; }
+        void setVoiceLevels( const double* levels ) { levels_ = levels; }
+        void setSampleRate( double sampleRate );
+        int getFadeSamples() const                  { return fadeSamples_; }
+        void advance( int numSamples );
 
         void setNumUnison( int numUnison );
         void setUnisonSpread( int cent );
@@ -39,6 +82,8 @@ namespace e3 {
         void setSustain( bool sustain );
         void setRetrigger( bool retrigger )         { retrigger_ = retrigger; }
         void setLegato( bool legato );
+        void setMpe( bool mpe );
+        bool getMpe() const                         { return mpe_; }
         double getPreviousPitch( int voice );
 
         VoiceList voices_;
@@ -46,23 +91,30 @@ namespace e3 {
 
         int numSounding_     = 0;
         int numActive_       = 0;
+        int numFading_       = 0;
         int numUnison_       = 1;
         double unisonSpread_ = 5;
+        Transport transport_;       // host tempo and position, set for every block
 
-        Gallant::Signal2<double, int>          midiPitchSignal;          // double pitch, uint16_t voice
-        Gallant::Signal2<double, int>          midiGateSignal;           // double gate, uint16_t voice
-        Gallant::Signal3<double, double, int>  midiNoteSignal;           // double pitch, double gate, uint16_t voice
-        Gallant::Signal1<int>                  midiPitchbendSignal;      // int value
-        Gallant::Signal2<double, int>          midiAftertouchSignal;     // double pitch, int value
-        Gallant::Signal2<int, int>             midiControllerSignal;     // uint16_t controllerNum, double value
+        // Events of the last handled messages, see Sink::processVoiceEvents().
+        const VoiceEventList& getVoiceEvents() const   { return events_; }
+        void clearVoiceEvents()                         { events_.clear(); }
 
     protected:
+        void addNoteEvent( double pitch, double gate, int voice, bool gateChanged = true );
+        void addVoiceEvents( VoiceEvent e, int channel, double pitch = -1 );
+        void addChannelState( int channel, int voice );
+        bool isMemberChannel( int channel ) const   { return mpe_ && channel != MpeMasterChannel; }
 
-        void noteOn( double pitch, double gate );
-        void noteOff( double pitch );
+        void noteOn( double pitch, double gate, int channel = MpeMasterChannel );
+        void noteOff( double pitch, int channel = MpeMasterChannel );
         void allNotesOff( bool reset );
 
-        int getUnusedVoice();
+        int getUnusedVoice( double pitch );
+        int getSilentVoice() const;
+        int findVictim( double pitch ) const;
+        double getStealRank( const Voice& voice, double pitch ) const;
+        void fadeVoice( int voice );
         void combineVoices( double basePitch, double gate );
         void updateSoundingVoices();
 
@@ -73,11 +125,30 @@ namespace e3 {
         bool sustain_     = false;
         bool retrigger_   = false;
         bool legato_      = false;
+        bool mpe_         = false;
         double lastPitch_ = -1;
         int numVoices_    = 0;
+        int maxVoices_    = 0;
+        int voiceLimit_   = 0;      // maxVoices_ set by the user
+        int capacity_     = 0;
+        bool adaptive_    = false;
         double tuning_    = 0;
 
+        StealPolicy stealPolicy_ = StealOldest;
+        const double* levels_    = nullptr;     // output envelope, per voice
+        int fadeSamples_         = 220;
+        std::vector< int > fadeCounters_;
+
         std::vector< Voice > stack_;
+        VoiceEventList events_;
+
+        struct ChannelState             // last values of an MPE member channel, for the next note
+        {
+            int bend        = 0x2000;
+            double pressure = 0;
+            double timbre   = 0.5;
+        };
+        ChannelState channels_[17];     // indexed by MIDI channel 1-16
 
     };
 
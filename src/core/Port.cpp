@@ -43,32 +43,6 @@ namespace e3 {
     }
 
 
-    void ModulationBuffer::onGate( uint32_t targetIndex, PortData& data, double gate, int voice )
-    {
-        if (data.veloSens_)
-        {
-            double value = data.valueShaper_.exponential( data.value_ );
-            value       += gate * data.veloSens_;
-
-            setValue( targetIndex, value, voice );
-        }
-    }
-
-
-    void ModulationBuffer::onController( uint32_t targetIndex, PortData& data, int16_t controllerId, double value )
-    {
-        UNUSED( targetIndex );
-        UNUSED( data );
-        UNUSED( controllerId );
-        UNUSED( value );
-        //if (link->scaleController(controllerId, value))
-        //{
-        //    link->value_ = value;
-        //    setValue( targetIndex, value, -1 );
-        //}
-    }
-
-
     //-------------------------------------------------------
     // class Port
     //-------------------------------------------------------
@@ -102,11 +76,14 @@ namespace e3 {
         }
         else if (getType() & PortTypeEvent) 
         {
-            addEventTarget( data, voiceAdapter );
-
             inport->connectEvent( data.rightPort_ );
-            eventInports_.resize( numEventConnections_ );
-            eventInports_.at( numEventConnections_ - 1 ) = inport;
+
+            EventTarget eventTarget;
+            eventTarget.module_  = target;
+            eventTarget.setter_  = inport->getEventSetter();
+            eventTarget.paramId_ = inport->eventParamId_;
+            eventTarget.adapter_ = voiceAdapter;
+            addEventTarget( data, eventTarget );
         }
     }
 
@@ -116,11 +93,10 @@ namespace e3 {
         audioData_.clear();
         eventData_.clear();
         audioAdapterBuffer_.clear();
-        eventAdapterBuffer_.clear();
         audioModulationBuffer_.clear();
         eventModulationBuffer_.clear();
         audioOutBuffer_.clear();
-        eventInports_.clear();
+        eventTargets_.clear();
 
         Port::disconnectAll();
     }
@@ -128,29 +104,28 @@ namespace e3 {
 
     void Outport::putEvent( double value, int_fast32_t voice )
     {
-        for (int_fast32_t target = 0; target < numEventConnections_; target++)
+        const EventTarget* eventTarget = eventTargets_.data();
+
+        for (int_fast32_t target = 0; target < numEventConnections_; target++, eventTarget++)
         {
             double modulation = eventModulationBuffer_[target * numVoices_ + voice];
+            Module* module    = eventTarget->module_;
+            EventSetter set   = eventTarget->setter_;
+            int paramId       = eventTarget->paramId_;
 
-            Inport* inport  = eventInports_.at( target );
-            ASSERT( inport );
-            Module* targetModule = inport->getOwner();
-            ASSERT( targetModule );
-
-            VoiceAdapterType adapter = eventAdapterBuffer_[target];
-            __assume(adapter < 3);
-            switch (adapter)
+            __assume(eventTarget->adapter_ < 3);
+            switch (eventTarget->adapter_)
             {
             case AdapterNone:
-                targetModule->setParameter( inport->eventParamId_, value, modulation, voice );
+                set( module, paramId, value, modulation, voice );
                 break;
             case AdapterMonoToPoly:
                 for (int_fast32_t i = 0; i < numVoices_; i++) {
-                    targetModule->setParameter( inport->eventParamId_, value, modulation, i );
+                    set( module, paramId, value, modulation, i );
                 }
                 break;
             case AdapterPolyToMono:
-                targetModule->setParameter( inport->eventParamId_, value, modulation, 0 );
+                set( module, paramId, value, modulation, 0 );
                 break;
             }
         }
@@ -168,13 +143,14 @@ namespace e3 {
     }
 
 
-    void Outport::addEventTarget( const PortData& data, VoiceAdapterType adapter )
+    void Outport::addEventTarget( const PortData& data, const EventTarget& target )
     {
+        ASSERT( target.module_ && target.setter_ );
+
         eventData_.push_back( data );
+        eventTargets_.push_back( target );
         numEventConnections_ = eventData_.size();
 
-        eventAdapterBuffer_.resize( numEventConnections_ );
-        eventAdapterBuffer_[numEventConnections_ - 1] = adapter;
         eventModulationBuffer_.init( numVoices_, eventData_ );
     }
 
@@ -188,16 +164,29 @@ namespace e3 {
     }
 
 
+    const double* Outport::getAudioModulation( int target )
+    {
+        ASSERT( target < numAudioConnections_ );
+        return &audioModulationBuffer_[target * numVoices_];
+    }
+
+
     bool Outport::setParameter( const Parameter& parameter )
     {
         ASSERT( parameter.isValid() && parameter.isLinkType() );
+        return setParameter( parameter.getId(), parameter.value_ );
+    }
 
+
+    bool Outport::setParameter( int linkId, double value )
+    {
         for (size_t i = 0; i < audioData_.size(); i++)
         {
-            const PortData& data = audioData_[i];
-            if (data.linkId_ == parameter.getId())
+            PortData& data = audioData_[i];
+            if (data.linkId_ == linkId)
             {
-                audioModulationBuffer_.setValue( i, parameter.value_ );
+                data.value_ = value;        // base of the per voice modulation, see ModulationMatrix
+                audioModulationBuffer_.setValue( i, value );
                 return true;
             }
         }
@@ -205,36 +194,13 @@ namespace e3 {
     }
 
 
-    void Outport::onGate(double gate, int voice)
-    {
-        for (int_fast32_t i = 0; i < numAudioConnections_; i++) {
-            audioModulationBuffer_.onGate( i, audioData_[i], gate, voice );
-        }
-        for (int_fast32_t i = 0; i < numEventConnections_; i++) {
-            eventModulationBuffer_.onGate( i, eventData_[i], gate, voice );
-        }
-    }
-
-
-    void Outport::onController(int16_t controllerId, double value)
-    {
-        for (int_fast32_t i = 0; i < numAudioConnections_; i++) {
-            audioModulationBuffer_.onController( i, audioData_[i], controllerId, value );
-        }
-        for (int_fast32_t i = 0; i < numEventConnections_; i++) {
-            eventModulationBuffer_.onController( i, eventData_[i], controllerId, value );
-        }
-    }
-
-
-
     //-------------------------------------------------------
     // class Inport
     //-------------------------------------------------------
 
     double* Inport::connectAudio()
     {
-        ASSERT( audioInBuffer_ && audioInBuffer_.size() == (size_t)numVoices_ );
+        ASSERT( audioInBuffer_ != nullptr );
 
         numAudioConnections_++;
         return audioInBuffer_;
@@ -275,13 +241,6 @@ namespace e3 {
     }
 
 
-    void Inport::setNumVoices( int numVoices )
-    {
-        Port::setNumVoices( numVoices );
-        audioInBuffer_.resize( numVoices_ );
-    }
-
-
     void Inport::setOwner( Module* module )  { owner_ = module; }
     Module* Inport::getOwner() const { return owner_; }
 
@@ -51,6 +51,24 @@ namespace e3 {
     };
 
 
+    // Direct entry point of an event inport. See Module::addInport() and Module::eventSetter().
+    typedef void ( *EventSetter )( Module* module, int paramId, double value, double modulation, int voice );
+
+
+    //------------------------------------------
+    // struct EventTarget
+    // An event connection, resolved when the ports are connected.
+    //------------------------------------------
+
+    struct EventTarget
+    {
+        Module* module_           = nullptr;
+        EventSetter setter_       = nullptr;
+        int paramId_              = -1;
+        VoiceAdapterType adapter_ = AdapterNone;
+    };
+
+
     //------------------------------------------
     // class PortData
     //------------------------------------------
@@ -74,9 +92,7 @@ namespace e3 {
     public:
         void init( int_fast32_t numVoices, PortDataList& data );
         void setValue( uint32_t targetIndex, double value, int voice = -1 );
-
-        void onGate( uint32_t targetIndex, PortData& data, double gate, int voice );
-        void onController( uint32_t targetIndex, PortData& data, int16_t controllerId, double value );
+        double* getValues( uint32_t targetIndex )    { return data_ + targetIndex * numVoices_; }
 
     protected:
         uint_fast32_t numVoices_;
@@ -162,16 +178,21 @@ namespace e3 {
 
         void setNumVoices( int numVoices ) override;
         bool setParameter( const Parameter& parameter );
+        bool setParameter( int linkId, double value );
+
+        // Per voice modulation of the audio connection with the given index. The pointer
+        // is valid until the port is connected again, Sink::fuse() takes it after every
+        // Instrument::connectModules().
+        const double* getAudioModulation( int target = 0 );
 
         void __stdcall putAudio( double value, int_fast32_t voice = 0 ) throw();
         void putEvent( double value, int_fast32_t voice );
 
-        void onGate( double gate, int voice );
-        void onController( int16_t controllerId, double value );
-
     protected:
+        friend class ModulationMatrix;
+
         void addAudioTarget( const PortData& data, VoiceAdapterType adapter );
-        void addEventTarget( const PortData& data, VoiceAdapterType adapter );
+        void addEventTarget( const PortData& data, const EventTarget& target );
 
     protected:
         PortDataList audioData_;
@@ -180,8 +201,7 @@ namespace e3 {
         ModulationBuffer audioModulationBuffer_;
 
         PortDataList eventData_;
-        InportList eventInports_;
-        Buffer< VoiceAdapterType > eventAdapterBuffer_;
+        std::vector< EventTarget > eventTargets_;
         ModulationBuffer eventModulationBuffer_;
     };
 
@@ -199,16 +219,19 @@ namespace e3 {
         void disconnectEvent();
         void disconnectAll() override;
 
-        void setNumVoices( int numVoices ) override;
         void setOwner( Module* module );
         Module* getOwner() const;
-        double* getAudioBuffer() const  { return audioInBuffer_; }
+        void setEventSetter( EventSetter setter )     { eventSetter_ = setter; }
+        EventSetter getEventSetter() const            { return eventSetter_; }
+        double* getAudioBuffer() const               { return audioInBuffer_; }
+        void setAudioBuffer( double* buffer )        { audioInBuffer_ = buffer; }
 
     protected:
-        Buffer<double> audioInBuffer_;
+        double* audioInBuffer_ = nullptr;       // numVoices_ values, owned by the module's arena
 
         Module* owner_ = nullptr;
         int eventParamId_    = -1;
+        EventSetter eventSetter_ = nullptr;
     };
 
 
@@ -4,10 +4,18 @@
 #include "gui/AudioEditor.h"
 #include "core/Settings.h"
 #include "core/InstrumentSerializer.h"
+#include "core/InstrumentState.h"
 #include "core/CpuMeter.h"
 #include "core/Polyphony.h"
 #include "core/Instrument.h"
 #include "core/Sink.h"
+#include "core/ParameterQueue.h"
+#include "core/HostParameters.h"
+#include "core/ControllerMap.h"
+#include "core/ModulationMatrix.h"
+#include "core/MultiTimbral.h"
+#include "core/AllocationGuard.h"
+#include "core/AudioTrace.h"
 
 #include "core/Processor.h"
 
@@ -25,23 +33,41 @@ namespace e3 {
     Processor::Processor() : AudioProcessor(),
         polyphony_( new Polyphony() ),
         sink_( new Sink() ),
-        cpuMeter_( new CpuMeter() )
+        cpuMeter_( new CpuMeter() ),
+        parameterQueue_( new ParameterQueue() ),
+        hostParameters_( new HostParameters() ),
+        controllerMap_( new ControllerMap() ),
+        modulationMatrix_( new ModulationMatrix() ),
+        multiTimbral_( new MultiTimbral() )
     {
         Settings::getInstance().load();
         setState( ProcessorNotInitialized );
+        startTimer( TimerInterval );
+#if E3_AUDIO_TRACE_LEVEL > 0
+        AudioTrace::start();
+#endif
     }
 
 
     Processor::~Processor()
     {
+#if E3_AUDIO_TRACE_LEVEL > 0
+        AudioTrace::stop();
+#endif
         if (sink_ != nullptr)  delete sink_;
     }
 
 
-    void Processor::prepareToPlay( double sampleRate, int )
+    void Processor::prepareToPlay( double sampleRate, int samplesPerBlock )
     {
+        inputBuffer_.setSize( NUMINPUTS, samplesPerBlock );
+        inputBuffer_.clear();
+
         sink_->setSampleRate( sampleRate );
+        polyphony_->setSampleRate( sampleRate );
+        polyphony_->setAdaptive( Settings::getInstance().getAdaptiveVoices() );
         cpuMeter_->setSampleRate( (uint32_t)sampleRate );
+        parameterQueue_->setSampleRate( sampleRate );
 
         if (instrument_ == nullptr)
         {
@@ -55,6 +81,12 @@ namespace e3 {
                 TRACE( e.what() );
             }
         }
+
+        if (partsLoaded_ == false) {
+            loadParts();
+        }
+        multiTimbral_->setVoiceBudget( Settings::getInstance().getVoiceBudget() );
+        multiTimbral_->init( sampleRate );
     }
 
 
@@ -81,17 +113,118 @@ namespace e3 {
     }
 
 
-    void Processor::getStateInformation( MemoryBlock& )
+    //-----------------------------------------------------
+    // Host parameters
+    //-----------------------------------------------------
+
+    int Processor::getNumParameters()
+    {
+        return hostParameters_->getNumParameters();
+    }
+
+
+    float Processor::getParameter( int index )
+    {
+        return hostParameters_->getValue( index );
+    }
+
+
+    // The host may call this from any thread, the value reaches the audio thread
+    // through the lock-free ring of HostParameters. This version of the plugin
+    // interface has no sample position, the change applies at the start of the next block.
+    void Processor::setParameter( int index, float value )
+    {
+        if (hostParameters_->setValue( index, value ) == false) {
+            TRACE( "Processor::setParameter: host parameter %d dropped\n", index );
+        }
+    }
+
+
+    const String Processor::getParameterName( int index )
     {
-        // You should use this method to store your parameters in the memory block.
-        // You could do that either as raw data, or use the XML or ValueTree classes
-        // as intermediaries to make it easy to save and load complex data.
+        return String( hostParameters_->getName( index ) );
     }
 
-    void Processor::setStateInformation( const void*, int )
+
+    const String Processor::getParameterText( int index )
     {
-        // You should use this method to restore your parameters from this memory block,
-        // whose contents will have been created by the getStateInformation() call.
+        return String( hostParameters_->getText( index ) );
+    }
+
+
+    void Processor::getStateInformation( MemoryBlock& destData )
+    {
+        if (instrument_ == nullptr) return;
+
+        std::vector< char > data;
+        InstrumentState( instrument_ ).write( data );
+        destData.setSize( 0 );
+        destData.append( data.data(), data.size() );
+    }
+
+
+    // A state of the loaded instrument and preset only updates the values that
+    // differ, the modules keep running. Any other state builds a new instrument.
+    //
+    void Processor::setStateInformation( const void* data, int sizeInBytes )
+    {
+        InstrumentState state;
+        try {
+            state.read( data, (size_t)std::max<int>( 0, sizeInBytes ) );
+        }
+        catch (const std::exception& e) {
+            TRACE( e.what() );
+            return;
+        }
+
+        if (instrument_ != nullptr && state.matches( instrument_ ))
+        {
+            const InstrumentState::Attributes& attributes = state.getAttributes();
+            if (attributes.numVoices != instrument_->numVoices_)       setInstrumentAttribute( "numVoices", attributes.numVoices );
+            if (attributes.numUnison != instrument_->numUnison_)       setInstrumentAttribute( "numUnison", attributes.numUnison );
+            if (attributes.unisonSpread != instrument_->unisonSpread_) setInstrumentAttribute( "unisonSpread", attributes.unisonSpread );
+            if (attributes.hold != instrument_->hold_)                 setInstrumentAttribute( "hold", attributes.hold );
+            if (attributes.retrigger != instrument_->retrigger_)       setInstrumentAttribute( "retrigger", attributes.retrigger );
+            if (attributes.legato != instrument_->legato_)             setInstrumentAttribute( "legato", attributes.legato );
+            if (attributes.mpe != instrument_->mpe_)                   setInstrumentAttribute( "mpe", attributes.mpe );
+            if (attributes.stealPolicy != instrument_->stealPolicy_)   setInstrumentAttribute( "stealPolicy", attributes.stealPolicy );
+
+            std::vector< ParameterChange > changes;
+            state.updateParameters( instrument_->getCurrentPreset(), changes );
+            for (size_t i = 0; i < changes.size(); i++)
+            {
+                parameterQueue_->post( changes[i] );
+                hostParameters_->onParameterChange( changes[i] );
+            }
+            return;
+        }
+
+        suspend();
+        ScopedPointer<Instrument> instrument;
+        try {
+            instrument = InstrumentSerializer::loadInstrument( "" );
+            if (instrument != nullptr) {
+                state.restore( instrument );
+            }
+        }
+        catch (const std::exception& e) {           // the current instrument keeps playing
+            TRACE( e.what() );
+            resume();
+            return;
+        }
+
+        if (instrument != nullptr)
+        {
+            try {
+                setInstrument( instrument.release() );
+            }
+            catch (const std::exception& e) {
+                TRACE( e.what() );
+                setState( ProcessorCrashed );
+                return;
+            }
+        }
+        resume();
     }
 
 
@@ -115,28 +248,35 @@ namespace e3 {
             saveInstrument();
         }
 
-        instrument_ = InstrumentSerializer::loadInstrument( path );        // this calls instrument::ctor first!
-        if (instrument_ != nullptr)
-        {
-            polyphony_->setNumVoices( instrument_->numVoices_ );
-            polyphony_->setNumUnison( instrument_->numUnison_ );
-            polyphony_->setUnisonSpread( instrument_->unisonSpread_ );
-            polyphony_->setHold( instrument_->hold_ );
-            polyphony_->setRetrigger( instrument_->retrigger_ );
-            polyphony_->setLegato( instrument_->legato_ );
-
-            initInstrument();
+        Instrument* instrument = InstrumentSerializer::loadInstrument( path );     // this calls instrument::ctor first!
+        if (instrument != nullptr) {
+            setInstrument( instrument );
+        }
+        else {
+            multiTimbral_->setMainInstrument( nullptr, nullptr );
+            instrument_ = nullptr;
         }
 
         resume();
     }
 
 
+    void Processor::setInstrument( Instrument* instrument )
+    {
+        instrument_ = instrument;
+        Part::setupPolyphony( polyphony_, instrument_ );
+        multiTimbral_->setMainInstrument( instrument_, polyphony_ );     // its share of the voice budget
+
+        hostParameters_->clear();       // another instrument, indices start over
+        initInstrument();
+    }
+
+
     void Processor::resetAndInitInstrument()
     {
         ASSERT( instrument_ );
         ASSERT( polyphony_ );
-        ASSERT( instrument_->numVoices_ == polyphony_->getNumVoices() );
+        ASSERT( instrument_->numVoices_ <= polyphony_->getCapacity() );
 
         polyphony_->allNotesOff( true );
         instrument_->resetModules();
@@ -146,12 +286,20 @@ namespace e3 {
 
     void Processor::initInstrument()
     {
-        instrument_->initModules( getSampleRate(), instrument_->numVoices_, polyphony_ );
+        parameterQueue_->clear();           // pending values are part of the preset already
+        sink_->sort( instrument_ );         // processing order, used for the memory layout of the modules
+        instrument_->initModules( getSampleRate(), polyphony_->getNumVoices(), polyphony_, sink_ );
         instrument_->loadPreset();
         instrument_->connectModules();
         instrument_->updateModules();
 
-        sink_->compile( instrument_ );
+        sink_->fuse( instrument_ );
+        controllerMap_->compile( instrument_->getCurrentPreset() );
+        modulationMatrix_->compile( instrument_, polyphony_->getNumVoices() );
+        polyphony_->setVoiceLevels( sink_->getOutputLevels() );
+
+        hostParameters_->update( instrument_ );
+        updateHostDisplay();
     }
 
 
@@ -228,6 +376,53 @@ namespace e3 {
     }
 
 
+    // The module reads its resource in initData(), e.g. a Sampler loads the file.
+    //
+    void Processor::setModuleResource( Module* module, const std::string& path )
+    {
+        ASSERT( module );
+        if (module == nullptr) return;
+
+        suspend();
+        try {
+            module->setResource( path );
+            saveInstrument();
+            resetAndInitInstrument();
+        }
+        catch (const std::exception& e) 
+        {
+            TRACE( e.what() );
+            setState( ProcessorCrashed );
+            return;
+        }
+        resume();
+    }
+
+
+    // A monophonic module gets the sum of its polyphonic sources, e.g. a Delay
+    // on the effect bus needs one buffer instead of one per voice.
+    //
+    void Processor::setModuleVoicing( Module* module, VoicingType voicingType )
+    {
+        ASSERT( module );
+        if (module == nullptr || module->getVoicingType() == voicingType) return;
+
+        suspend();
+        try {
+            module->setVoicingType( voicingType );
+            saveInstrument();
+            resetAndInitInstrument();
+        }
+        catch (const std::exception& e) 
+        {
+            TRACE( e.what() );
+            setState( ProcessorCrashed );
+            return;
+        }
+        resume();
+    }
+
+
     void Processor::setInstrumentAttribute( const std::string& name, const var& value )
     {
         ASSERT( instrument_ );
@@ -248,7 +443,11 @@ namespace e3 {
         }
         else if (name == "hold") {
             instrument_->setHold( value );
+
+            const ScopedLock scopedLock( lock_ );       // releasing hold ends notes
             polyphony_->setHold( value );
+            modulationMatrix_->processVoiceEvents( polyphony_->getVoiceEvents() );
+            sink_->processVoiceEvents( polyphony_ );
         }
         else if (name == "retrigger") {
             instrument_->setRetrigger( value );
@@ -258,16 +457,193 @@ namespace e3 {
             instrument_->setLegato( value );
             polyphony_->setLegato( value );
         }
+        else if (name == "mpe") {
+            instrument_->setMpe( value );
+
+            const ScopedLock scopedLock( lock_ );
+            polyphony_->setMpe( value );
+        }
+        else if (name == "stealPolicy") {
+            instrument_->setStealPolicy( value );
+
+            const ScopedLock scopedLock( lock_ );
+            polyphony_->setStealPolicy( (Polyphony::StealPolicy)instrument_->stealPolicy_ );
+        }
         InstrumentSerializer::saveAttribute( instrument_, name, value );
     }
 
 
+    void Processor::queueParameter( const Parameter& parameter, double previousValue )
+    {
+        parameterQueue_->post( ParameterChange( parameter, previousValue ) );
+
+        if (controllerMap_->matches( parameter ) == false)      // the controller assignment was edited
+        {
+            ScopedPointer<ControllerMap> controllerMap( new ControllerMap() );
+            controllerMap->compile( instrument_->getCurrentPreset() );
+
+            const ScopedLock scopedLock( lock_ );
+            controllerMap_.swapWith( controllerMap );
+        }
+
+        int index = hostParameters_->onParameterChange( ParameterChange( parameter, previousValue ) );     // let the host record the change
+        if (index >= 0) {
+            sendParamChangeMessageToListeners( index, hostParameters_->getValue( index ) );
+        }
+    }
+
+
+    // Changes that do not fit into the parameter queue are retried until they
+    // are through, so the audio thread always ends up with the last value.
+    // Values the host has automated go into the preset, so they are saved.
+    //
+    void Processor::timerCallback()
+    {
+        parameterQueue_->flush();
+
+        if (instrument_ != nullptr) {
+            hostParameters_->storeValues( instrument_ );
+        }
+    }
+
+
+    //------------------------------------------------------------------------------
+    // Multi-timbral parts
+    //------------------------------------------------------------------------------
+
+    namespace {
+
+        MidiZone readZone( XmlElement* e )
+        {
+            return MidiZone(
+                e->getIntAttribute( "first-channel", 1 ),
+                e->getIntAttribute( "last-channel", 16 ),
+                e->getIntAttribute( "low-key", 0 ),
+                e->getIntAttribute( "high-key", 127 ) );
+        }
+
+        void writeZone( XmlElement* e, const MidiZone& zone )
+        {
+            e->setAttribute( "first-channel", zone.firstChannel );
+            e->setAttribute( "last-channel", zone.lastChannel );
+            e->setAttribute( "low-key", zone.lowKey );
+            e->setAttribute( "high-key", zone.highKey );
+        }
+    }
+
+
+    Part* Processor::addPart( const std::string& path, const MidiZone& zone )
+    {
+        Part* part = nullptr;
+        bool nested = suspend();
+        try {
+            Instrument* instrument = InstrumentSerializer::loadInstrument( path );
+            if (instrument != nullptr) 
+            {
+                part = multiTimbral_->addPart( instrument, zone );
+                if (part == nullptr) {
+                    delete instrument;
+                }
+                else {
+                    multiTimbral_->init( getSampleRate() );
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            TRACE( e.what() );
+        }
+        resume( nested );
+
+        if (part != nullptr) {
+            storeParts();
+        }
+        return part;
+    }
+
+
+    void Processor::removePart( int index )
+    {
+        bool nested = suspend();
+        multiTimbral_->removePart( index );
+        resume( nested );
+        storeParts();
+    }
+
+
+    void Processor::setZone( const MidiZone& zone )
+    {
+        const ScopedLock scopedLock( lock_ );
+        zone_ = zone;
+        polyphony_->allNotesOff( true );
+        sink_->processVoiceEvents( polyphony_ );
+        storeParts();
+    }
+
+
+    void Processor::loadParts()
+    {
+        partsLoaded_ = true;
+        XmlElement* partsXml = Settings::getInstance().getPartsXml();
+        if (partsXml == nullptr) return;
+
+        zone_ = readZone( partsXml );
+        forEachXmlChildElementWithTagName( *partsXml, e, "part" )
+        {
+            try {
+                Instrument* instrument = InstrumentSerializer::loadInstrument( e->getStringAttribute( "path" ).toStdString() );
+                Part* part = (instrument != nullptr) ? multiTimbral_->addPart( instrument, readZone( e ) ) : nullptr;
+                if (part != nullptr) {
+                    part->setGain( e->getDoubleAttribute( "gain", 1 ) );
+                }
+                else if (instrument != nullptr) {
+                    delete instrument;
+                }
+            }
+            catch (const std::exception& ex) {          // file missing, skip the part
+                TRACE( ex.what() );
+            }
+        }
+    }
+
+
+    void Processor::storeParts()
+    {
+        XmlElement* partsXml = Settings::getInstance().getPartsXml();
+        if (partsXml == nullptr) return;
+
+        partsXml->deleteAllChildElements();
+        writeZone( partsXml, zone_ );
+        for (int i = 0; i < multiTimbral_->getNumParts(); i++)
+        {
+            Part* part    = multiTimbral_->getPart( i );
+            XmlElement* e = partsXml->createNewChildElement( "part" );
+            e->setAttribute( "path", part->getInstrument()->getFilePath().getFullPathName() );
+            e->setAttribute( "gain", part->getGain() );
+            writeZone( e, part->getZone() );
+        }
+    }
+
+
+    // Within the capacity of Polyphony the number of voices changes on the fly,
+    // only a larger number reallocates the modules.
+    //
     void Processor::setNumVoices( int numVoices )
     {
+        numVoices = std::max<int>( 1, numVoices );
+        if (numVoices <= polyphony_->getCapacity())
+        {
+            instrument_->setNumVoices( numVoices );
+
+            const ScopedLock scopedLock( lock_ );
+            multiTimbral_->setMainInstrument( instrument_, polyphony_ );
+            return;
+        }
+
         suspend();
         try {
             polyphony_->setNumVoices( numVoices );
             instrument_->setNumVoices( numVoices );
+            multiTimbral_->setMainInstrument( instrument_, polyphony_ );
             resetAndInitInstrument();
         }
         catch (const std::exception& e)
@@ -326,11 +702,76 @@ namespace e3 {
     // Processing
     //-------------------------------------------------------
 
+    // The host processes in place, the output of the instruments overwrites the
+    // input. The AudioInTerminals read from a copy made once per block.
+    // Returns nullptr if the block is larger than announced in prepareToPlay().
+    //
+    const AudioSampleBuffer* Processor::copyInput( const AudioSampleBuffer& audioBuffer )
+    {
+        int numSamples  = audioBuffer.getNumSamples();
+        int numChannels = std::min<int>( getNumInputChannels(), audioBuffer.getNumChannels() );
+        if (numChannels <= 0) {
+            return nullptr;
+        }
+        if (numSamples > inputBuffer_.getNumSamples()) {
+            AUDIO_TRACE( AudioTraceError, TraceInputDropped, numSamples, inputBuffer_.getNumSamples() );
+            return nullptr;
+        }
+
+        for (int channel = 0; channel < inputBuffer_.getNumChannels(); channel++)
+        {
+            if (channel < numChannels) {
+                inputBuffer_.copyFrom( channel, 0, audioBuffer, channel, 0, numSamples );
+            }
+            else {
+                inputBuffer_.clear( channel, 0, numSamples );
+            }
+        }
+        return &inputBuffer_;
+    }
+
+
+    // Tempo synced modules read the transport from their Polyphony. Without a
+    // playhead the tempo stays as it was and the position does not move.
+    //
+    void Processor::updateTransport()
+    {
+        Transport& transport = polyphony_->transport_;
+        transport.block++;
+
+        AudioPlayHead* playHead = getPlayHead();
+        AudioPlayHead::CurrentPositionInfo info;
+        if (playHead != nullptr && playHead->getCurrentPosition( info ))
+        {
+            if (info.bpm > 0) {
+                transport.bpm = info.bpm;
+            }
+            transport.ppqPosition = info.ppqPosition;
+            transport.playing     = info.isPlaying;
+        }
+        else {
+            transport.playing = false;
+        }
+        multiTimbral_->setTransport( transport );
+    }
+
+
     void Processor::processBlock( AudioSampleBuffer& audioBuffer, MidiBuffer& midiBuffer )
     {
         const ScopedLock scopedLock( lock_ );
+        if (instrument_ == nullptr)                 // loading has failed
+        {
+            audioBuffer.clear();
+            return;
+        }
+        const AllocationGuard allocationGuard;      // debug builds report allocations from here on
         cpuMeter_->start();
-        audioBuffer.clear();    // input not implemented
+
+        const AudioSampleBuffer* input = copyInput( audioBuffer );
+        sink_->setInput( input );
+        multiTimbral_->setInput( input );
+        audioBuffer.clear();
+        updateTransport();
 
         int startSample  = 0;
         int totalSamples = audioBuffer.getNumSamples();
@@ -340,29 +781,62 @@ namespace e3 {
         midiIterator.setNextSamplePosition( startSample );
         MidiMessage msg( 0xf4, 0.0 );
         int midiEventPos;
-        bool hasEvent;
+        bool hasEvent = midiIterator.getNextEvent( msg, midiEventPos );
 
-        while (numSamples > 0)
-        {
-            hasEvent  = midiIterator.getNextEvent( msg, midiEventPos );
-            hasEvent &= midiEventPos < startSample + numSamples;
+        parameterQueue_->update( instrument_, controllerMap_ );
 
-            const int numSamplesNow = hasEvent ? midiEventPos - startSample : numSamples;
+        hostParameters_->collect( totalSamples );
+        ParameterChange hostChange;
+        int hostChangePos;
+        bool hasHostChange = hostParameters_->getNextChange( hostChange, hostChangePos );
 
-            if (numSamplesNow > 0) {
+        while (numSamples > 0)
+        {
+            bool eventNow     = hasEvent && midiEventPos < startSample + numSamples;
+            int nextPos       = eventNow ? midiEventPos : startSample + numSamples;
+            nextPos           = hasHostChange ? std::min<int>( nextPos, hostChangePos ) : nextPos;
+            int numSamplesNow = nextPos - startSample;
+
+            if (numSamplesNow > 0)
+            {
+                if (parameterQueue_->isRamping())
+                {
+                    numSamplesNow = std::min<int>( numSamplesNow, ParameterQueue::ControlBlockSize );
+                    parameterQueue_->advance( instrument_, numSamplesNow );
+                }
+                modulationMatrix_->update();
                 sink_->process( audioBuffer, startSample, numSamplesNow );
-            }
+                polyphony_->advance( numSamplesNow );
+                multiTimbral_->process( audioBuffer, startSample, numSamplesNow );
 
-            if (hasEvent) {
-                polyphony_->handleMidiMessage( msg );
+                startSample += numSamplesNow;
+                numSamples  -= numSamplesNow;
+            }
+            else if (hasHostChange && hostChangePos <= startSample)
+            {
+                controllerMap_->onParameterChange( hostChange );
+                parameterQueue_->add( instrument_, hostChange );    // applied by advance() from this sample on
+                hasHostChange = hostParameters_->getNextChange( hostChange, hostChangePos );
+            }
+            else if (eventNow)
+            {
+                if (zone_.accepts( msg ))
+                {
+                    if (msg.isController()) {      // applied by advance() from this sample on
+                        controllerMap_->handleController( msg.getChannel() - 1, msg.getControllerNumber(), msg.getControllerValue(), instrument_, parameterQueue_ );
+                    }
+                    polyphony_->handleMidiMessage( msg );
+                    modulationMatrix_->processVoiceEvents( polyphony_->getVoiceEvents() );
+                    sink_->processVoiceEvents( polyphony_ );
+                }
+                multiTimbral_->handleMidiMessage( msg );
+                hasEvent = midiIterator.getNextEvent( msg, midiEventPos );
             }
-
-            startSample += numSamplesNow;
-            numSamples  -= numSamplesNow;
         }
 
         if (cpuMeter_->stop( totalSamples )) {
             polyphony_->monitorCpuMeterEvent( cpuMeter_->getPercent() );
+            polyphony_->adaptToCpuLoad( cpuMeter_->getPercent() );
         }
     }
 
@@ -14,6 +14,7 @@
 
 #include "JuceHeader.h"
 #include "core/GlobalHeader.h"
+#include "core/Part.h"
 
 
 namespace e3 {
@@ -24,6 +25,13 @@ namespace e3 {
     class Sink;
     class Module;
     class Link;
+    class Parameter;
+    class ParameterQueue;
+    struct ParameterChange;
+    class HostParameters;
+    class ControllerMap;
+    class ModulationMatrix;
+    class MultiTimbral;
 
     enum ProcessorState {
         ProcessorNotInitialized = 0,
@@ -37,7 +45,7 @@ namespace e3 {
     //
     //-----------------------------------------------------------------
     //
-    class Processor : public AudioProcessor
+    class Processor : public AudioProcessor, private Timer
     {
     public:
         Processor();
@@ -55,12 +63,12 @@ namespace e3 {
 
         const String getName() const override                               { return JucePlugin_Name; }
 
-        int getNumParameters() override                                     { return 0; }
-        float getParameter( int ) override                                    { return 0.0f; }
-        void setParameter( int, float ) override                              {}
+        int getNumParameters() override;
+        float getParameter( int index ) override;
+        void setParameter( int index, float value ) override;
 
-        const String getParameterName( int ) override                         { return String(); }
-        const String getParameterText( int ) override                         { return String(); }
+        const String getParameterName( int index ) override;
+        const String getParameterText( int index ) override;
 
         const String getInputChannelName( int channelIndex ) const override   { return String( channelIndex + 1 ); }
         const String getOutputChannelName( int channelIndex ) const override  { return String( channelIndex + 1 ); }
@@ -92,23 +100,50 @@ namespace e3 {
 
         Module* addModule( int moduleType );
         void deleteModule( Module* module );
+        void setModuleResource( Module* module, const std::string& path );
+        void setModuleVoicing( Module* module, VoicingType voicingType );
 
         Instrument* getInstrument() const   { return instrument_; }
         void setInstrumentAttribute( const std::string& attrName, const var& value );
 
-        Gallant::Signal2<int, int> midiControllerSignal;
+        // Passes a changed parameter value to the audio thread. Call from the message thread only.
+        void queueParameter( const Parameter& parameter, double previousValue );
+
+        // Multi-timbral mode: more instruments that play along with the edited one,
+        // each in its own MidiZone. The parts are stored in the settings.
+        Part* addPart( const std::string& path, const MidiZone& zone );
+        void removePart( int index );
+        MultiTimbral* getMultiTimbral() const   { return multiTimbral_; }
+        void setZone( const MidiZone& zone );
+        const MidiZone& getZone() const         { return zone_; }
 
     private:
+        enum { TimerInterval = 20 };               // msec
+
+        void setInstrument( Instrument* instrument );
         void initInstrument();
         void resetAndInitInstrument();
         void setNumVoices( int numVoices );
         void setState( ProcessorState state );
+        void loadParts();
+        void storeParts();
+        const AudioSampleBuffer* copyInput( const AudioSampleBuffer& audioBuffer );
+        void updateTransport();
+        void timerCallback() override;
 
 
         Sink* sink_ = nullptr;
         ScopedPointer<Polyphony> polyphony_;
         ScopedPointer<Instrument> instrument_;
         ScopedPointer<CpuMeter> cpuMeter_;
+        ScopedPointer<ParameterQueue> parameterQueue_;
+        ScopedPointer<HostParameters> hostParameters_;
+        ScopedPointer<ControllerMap> controllerMap_;
+        ScopedPointer<ModulationMatrix> modulationMatrix_;
+        ScopedPointer<MultiTimbral> multiTimbral_;
+        MidiZone zone_;                     // of the edited instrument
+        bool partsLoaded_ = false;
+        AudioSampleBuffer inputBuffer_;     // the host input, see copyInput()
 
         ProcessorState state_ = ProcessorNotInitialized;
         CriticalSection lock_;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <emmintrin.h>
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class Random
+    // Noise for the audio thread: four xorshift32 generators in the lanes of
+    // an SSE2 register yield four values per call. A module keeps NumLanes
+    // state words and values per voice, allocated from its arena, and takes
+    // one value per frame. seed() derives the lanes from a seed with
+    // splitmix32, so a module that seeds a voice by its id, the voice and the
+    // note renders the same noise for the same note in the same voice.
+    //--------------------------------------------------------------------------
+
+    class Random
+    {
+    public:
+        enum { NumLanes = 4 };
+
+        // Fills the NumLanes words of state, none of them is zero.
+        static void seed( uint32_t* state, uint32_t seed )
+        {
+            for (int i = 0; i < NumLanes; i++)
+            {
+                uint32_t z = (seed += 0x9e3779b9);
+                z = (z ^ (z >> 16)) * 0x85ebca6b;
+                z = (z ^ (z >> 13)) * 0xc2b2ae35;
+                z = z ^ (z >> 16);
+                state[i] = (z != 0) ? z : 0x6d2b79f5;
+            }
+        }
+
+        // Writes NumLanes values in [-1, 1) and advances the state.
+        static __forceinline void generate( uint32_t* state, float* values ) throw()
+        {
+            __m128i x = _mm_loadu_si128( reinterpret_cast<const __m128i*>(state) );
+            x = _mm_xor_si128( x, _mm_slli_epi32( x, 13 ) );
+            x = _mm_xor_si128( x, _mm_srli_epi32( x, 17 ) );
+            x = _mm_xor_si128( x, _mm_slli_epi32( x, 5 ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(state), x );
+
+            __m128 f = _mm_mul_ps( _mm_cvtepi32_ps( x ), _mm_set1_ps( 1.f / 2147483648.f ) );
+            _mm_storeu_ps( values, f );
+        }
+
+        // The note is the key that started the voice, 0 before the first note.
+        static uint32_t getSeed( int moduleId, int voice, int seed, int note = 0 )
+        {
+            return (uint32_t)moduleId * 0x01000193u ^ (uint32_t)voice * 0x9e3779b9u ^ (uint32_t)seed * 0x85ebca6bu ^ (uint32_t)note * 0xc2b2ae35u;
+        }
+    };
+
+} // namespace e3
@@ -159,6 +159,23 @@ namespace e3 {
     }
 
 
+    // Multi-timbral parts, see Processor::loadParts()
+    XmlElement* Settings::getPartsXml() const
+    {
+        if (root_ != nullptr)
+        {
+            XmlElement* partsXml = getElement( "parts" );
+            if (partsXml == nullptr) 
+            {
+                partsXml = new XmlElement( "parts" );
+                root_->addChildElement( partsXml );
+            }
+            return partsXml;
+        }
+        return nullptr;
+    }
+
+
     std::string Settings::getWindowState( const std::string& context ) const
     {
         std::string defaultState = "0 0 1000 700";
@@ -205,6 +222,22 @@ namespace e3 {
     }
 
 
+    // Lets Polyphony reduce the number of voices when the cpu load is high.
+    bool Settings::getAdaptiveVoices() const
+    {
+        XmlElement* e = getElement( "application" );
+        return e->getBoolAttribute( "adaptive-voices" );
+    }
+
+
+    // Voices of all multi-timbral parts together, 0: no limit
+    int Settings::getVoiceBudget() const
+    {
+        XmlElement* e = getElement( "application" );
+        return e->getIntAttribute( "voice-budget", 0 );
+    }
+
+
 #ifdef BUILD_TARGET_APP
 
     void Settings::loadAudioDevices( AudioDeviceManager* manager, int numInputChannels, int numOutputChannels )
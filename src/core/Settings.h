@@ -24,6 +24,7 @@ namespace e3 {
 
         XmlElement* getStyleXml( const std::string& name = "Default" ) const;
         XmlElement* getDatabaseXml() const;
+        XmlElement* getPartsXml() const;
 
         std::string getWindowState( const std::string& context ) const;
         void setWindowState( const std::string& state, const std::string& context );
@@ -33,6 +34,8 @@ namespace e3 {
 
 		bool getAutosavePresets() const;
 		bool getAutosaveInstruments() const;
+		bool getAdaptiveVoices() const;
+		int getVoiceBudget() const;
 
 #ifdef BUILD_TARGET_APP
         void loadAudioDevices( AudioDeviceManager* manager, int numInputChannels, int numOutputChannels );
@@ -56,8 +59,9 @@ namespace e3 {
 
         const char* rootTagname_ = "e3m-settings";
 		std::string defaultXml_ =
-			"<application autosave-presets='1' autosave-instruments='1' recent-instrument='' style='Default' />"
+			"<application autosave-presets='1' autosave-instruments='1' adaptive-voices='0' voice-budget='0' recent-instrument='' style='Default' />"
 			"<database path='' />"
+			"<parts />"
 			"<standalone>"
 			"<window state='10 10 1000 700' />"
 			"<audio-devices device-type = '' output-device = '' input-device = '' "
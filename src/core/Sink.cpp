@@ -1,8 +1,14 @@
 
 #include <queue>
+#include <algorithm>
+#include <unordered_map>
+#include <functional>
+#include <sstream>
+#include <e3_Trace.h>
 
 #include "core/Module.h"
 #include "core/Instrument.h"
+#include "core/Polyphony.h"
 #include "modules/AudioOutTerminal.h"
 #include "modules/AdsrEnvelope.h"
 #include "core/Sink.h"
@@ -13,17 +19,37 @@ namespace e3 {
     Sink::Sink() : ModuleList()
     {
         reserve(100);
+        zero_[0] = zero_[1] = 0;
     }
 
 
     void Sink::reset()
     {
         ModuleList::clear();
-        audioOutPointer_ = &zero_;
+        compiled_.clear();
+        collected_.clear();
+        eventSources_.clear();
+        inputTerminals_.clear();
+        outputEnvelope_ = nullptr;
+        feedbackLinks_.clear();
+        feedbackLinkIds_.clear();
+        fusedLinks_.clear();
+        numFeedbackLoops_ = 0;
+        audioOutPointer_  = zero_;
     }
 
     
     void Sink::compile(Instrument* instrument)
+    {
+        sort( instrument );
+        fuse( instrument );
+    }
+
+
+    // Needs the links of the instrument only, the modules may be uninitialized.
+    // Processor uses the order for the memory layout of the modules.
+    //
+    void Sink::sort( Instrument* instrument )
     {
         reset();
 
@@ -31,54 +57,349 @@ namespace e3 {
         if (nullptr == audioOut)    // nothing to do
             return;
 
-        bool hasOutputEnvelope  = false;
-        Module* module = audioOut;
+        collectModules( instrument, audioOut );
+        findFeedbackLinks( instrument );
+        sortModules( instrument );
+        collectEventSources();
+        collectInputTerminals();
+
+        audioOutPointer_ = audioOut->output_;
+    }
+
+
+    // Needs initialized and connected modules.
+    void Sink::fuse( Instrument* instrument )
+    {
+        if (collected_.empty())     // nothing to do
+            return;
+
+        fuseModules( instrument );
+        TRACE( "Sink::compile: %s\n", toString().c_str() );
+    }
+
+
+    // The MIDI modules, in processing order. They receive the voice events
+    // of each MIDI message in one call, see processVoiceEvents().
+    //
+    void Sink::collectEventSources()
+    {
+        for (ModuleList::const_iterator it = begin(); it != end(); ++it)
+        {
+            Module* module = *it;
+            if (module->processingType_ & ProcessEvent) {
+                eventSources_.push_back( module );
+            }
+        }
+    }
+
+
+    void Sink::collectInputTerminals()
+    {
+        for (ModuleList::const_iterator it = begin(); it != end(); ++it)
+        {
+            Module* module = *it;
+            if (module->moduleType_ == ModuleTypeAudioInTerminal) {
+                inputTerminals_.push_back( module );
+            }
+        }
+    }
+
+
+    void Sink::processVoiceEvents( Polyphony* polyphony )
+    {
+        const VoiceEventList& events = polyphony->getVoiceEvents();
+        if (events.empty()) return;
+
+        for (ModuleList::const_iterator it = eventSources_.begin(); it != eventSources_.end(); ++it) {
+            (*it)->processVoiceEvents( events );
+        }
+        if (outputEnvelope_ != nullptr) {
+            outputEnvelope_->processVoiceEvents( events );
+        }
+        polyphony->clearVoiceEvents();
+    }
+
+
+    // Levels of the output envelope, per voice. Polyphony uses them to steal the quietest voice.
+    const double* Sink::getOutputLevels() const
+    {
+        return outputEnvelope_ != nullptr ? outputEnvelope_->getLevels() : nullptr;
+    }
+
+
+    // Collects all modules the AudioOutTerminal depends on, walking the links 
+    // backwards. Modules that do not reach the output are left out.
+    //
+    void Sink::collectModules( Instrument* instrument, Module* audioOut )
+    {
+        bool hasOutputEnvelope = false;
 
         std::queue< Module* > queue;
-        queue.push(module);
+        queue.push( audioOut );
 
         while (queue.empty() == false)
         {
-            module = queue.front();
+            Module* module = queue.front();
+            queue.pop();
 
             if (hasOutputEnvelope == false) {
                 hasOutputEnvelope = checkOutputEnvelope( module );
             }
 
-            if (module->processingType_ & (ProcessAudio | ProcessEvent))
+            if ((module->processingType_ & (ProcessAudio | ProcessEvent)) && contains( module ) == false)
             {
-                if (contains(module) == false) 
+                compiled_.insert( module );
+                collected_.push_back( module );
+
+                const LinkList& links = instrument->getInboundLinks( module->id_ );
+                for (LinkList::const_iterator it = links.begin(); it != links.end(); ++it)
                 {
-                    push_back(module);
-
-                    LinkList links;
-                    instrument->getLinksForModule( module->id_, PortTypeInport, links );
-
-                    for (LinkList::const_iterator it = links.begin(); it != links.end(); ++it)
-                    {
-                        const Link& link = *it;
-                        Module* next = instrument->getModule( link.leftModule_ );
-                        if (next && next != module) {
-                            queue.push( next );                 // enqueue sources of current module
-                        }
+                    Module* next = instrument->getModule( it->leftModule_ );
+                    if (next && next != module) {
+                        queue.push( next );                 // enqueue sources of current module
                     }
                 }
             }
-            queue.pop();
         }
+    }
+
+
+    //--------------------------------------------------------------------------
+    // class FeedbackFinder
+    // Tarjan's algorithm for strongly connected components, searching from the
+    // output towards the sources. Every link whose source is already on the
+    // current search path closes a loop and is stored as feedback link, so the
+    // link farthest upstream gets cut.
+    //--------------------------------------------------------------------------
+
+    class FeedbackFinder
+    {
+    public:
+        FeedbackFinder( Instrument* instrument, const std::unordered_set< Module* >& modules, LinkList& feedbackLinks ) :
+            instrument_( instrument ),
+            modules_( modules ),
+            feedbackLinks_( feedbackLinks )
+        {}
 
-        reverse(begin(), end());
-        audioOutPointer_ = &(audioOut->value_);
+        int run( const ModuleList& modules )
+        {
+            for (ModuleList::const_iterator it = modules.begin(); it != modules.end(); ++it) 
+            {
+                if (index_.find( *it ) == index_.end()) {
+                    visit( *it );
+                }
+            }
+            return numLoops_;
+        }
+
+    protected:
+        void visit( Module* module )
+        {
+            int index = counter_++;
+            index_[module]   = index;
+            lowlink_[module] = index;
+            stack_.push_back( module );
+            onStack_.insert( module );
+            onPath_.insert( module );
+
+            const LinkList& links = instrument_->getInboundLinks( module->getId() );
+            for (LinkList::const_iterator it = links.begin(); it != links.end(); ++it)
+            {
+                const Link& link = *it;
+                Module* target   = instrument_->getModule( link.leftModule_ );
+                if (target == nullptr || modules_.find( target ) == modules_.end()) 
+                    continue;
+
+                if (onPath_.find( target ) != onPath_.end()) {
+                    feedbackLinks_.push_back( link );       // includes links of a module to itself
+                    if (target == module) selfLinked_.insert( module );
+                }
+                if (index_.find( target ) == index_.end())
+                {
+                    visit( target );
+                    lowlink_[module] = std::min( lowlink_[module], lowlink_[target] );
+                }
+                else if (onStack_.find( target ) != onStack_.end()) {
+                    lowlink_[module] = std::min( lowlink_[module], index_[target] );
+                }
+            }
+            onPath_.erase( module );
+
+            if (lowlink_[module] == index)           // module is the root of a component
+            {
+                size_t size = 0;
+                Module* member;
+                do {
+                    member = stack_.back();
+                    stack_.pop_back();
+                    onStack_.erase( member );
+                    size++;
+                } while (member != module);
+
+                if (size > 1 || selfLinked_.find( module ) != selfLinked_.end()) {
+                    numLoops_++;
+                }
+            }
+        }
+
+        Instrument* instrument_;
+        const std::unordered_set< Module* >& modules_;
+        LinkList& feedbackLinks_;
+
+        std::unordered_map< Module*, int > index_, lowlink_;
+        std::unordered_set< Module* > onStack_, onPath_, selfLinked_;
+        ModuleList stack_;
+        int counter_  = 0;
+        int numLoops_ = 0;
+
+    private:
+        FeedbackFinder& operator=( const FeedbackFinder& ) = delete;
+    };
+
+
+    void Sink::findFeedbackLinks( Instrument* instrument )
+    {
+        FeedbackFinder finder( instrument, compiled_, feedbackLinks_ );
+        numFeedbackLoops_ = finder.run( collected_ );
+
+        for (LinkList::const_iterator it = feedbackLinks_.begin(); it != feedbackLinks_.end(); ++it) {
+            feedbackLinkIds_.insert( it->getId() );
+        }
     }
 
 
-    bool Sink::contains(Module* module)
+    // Kahn's algorithm. Feedback links are ignored, so the remaining graph is acyclic.
+    // Independent modules are ordered by id to get the same order on every compile.
+    //
+    void Sink::sortModules( Instrument* instrument )
     {
-        for (size_t i = 0; i < size(); i++) {
-            if (operator[](i) == module)
-                return true;
+        std::unordered_map< Module*, int > numInputs;
+        std::priority_queue< int, std::vector< int >, std::greater< int > > ready;
+
+        for (ModuleList::const_iterator it = collected_.begin(); it != collected_.end(); ++it)
+        {
+            Module* module = *it;
+            int count      = 0;
+
+            const LinkList& links = instrument->getInboundLinks( module->id_ );
+            for (LinkList::const_iterator lit = links.begin(); lit != links.end(); ++lit)
+            {
+                Module* source = instrument->getModule( lit->leftModule_ );
+                if (source && contains( source ) && isFeedbackLink( *lit ) == false) {
+                    count++;
+                }
+            }
+            numInputs[module] = count;
+            if (count == 0) {
+                ready.push( module->id_ );
+            }
         }
-        return false;
+
+        while (ready.empty() == false)
+        {
+            Module* module = instrument->getModule( ready.top() );
+            ready.pop();
+            push_back( module );
+
+            const LinkList& links = instrument->getOutboundLinks( module->id_ );
+            for (LinkList::const_iterator it = links.begin(); it != links.end(); ++it)
+            {
+                Module* target = instrument->getModule( it->rightModule_ );
+                if (target && contains( target ) && isFeedbackLink( *it ) == false)
+                {
+                    if (--numInputs[target] == 0) {
+                        ready.push( target->id_ );
+                    }
+                }
+            }
+        }
+        ASSERT( size() == collected_.size() );
+    }
+
+
+    // Lets each module take over the processing of a source that feeds only this module,
+    // e.g. Sine->ADSR or Sine-FM->Sine. The source is removed from the processing order.
+    //
+    void Sink::fuseModules( Instrument* instrument )
+    {
+        std::unordered_set< Module* > fused;
+
+        for (const_iterator it = begin(); it != end(); ++it)
+        {
+            Module* target = *it;
+
+            const LinkList& links = instrument->getInboundLinks( target->id_ );
+            for (LinkList::const_iterator lit = links.begin(); lit != links.end(); ++lit)
+            {
+                const Link& link = *lit;
+                Module* source   = instrument->getModule( link.leftModule_ );
+
+                if (source && fused.find( source ) == fused.end() && canFuse( source, target, link ) &&
+                    target->fuseSource( source, link ))
+                {
+                    fused.insert( source );
+                    fusedLinks_.push_back( link );
+                    break;
+                }
+            }
+        }
+
+        for (std::unordered_set< Module* >::const_iterator it = fused.begin(); it != fused.end(); ++it) {
+            compiled_.erase( *it );
+        }
+        erase( std::remove_if( begin(), end(), [&fused]( Module* m ) { return fused.find( m ) != fused.end(); } ), end() );
+    }
+
+
+    bool Sink::canFuse( Module* source, Module* target, const Link& link ) const
+    {
+        if (source == target || compiled_.find( source ) == compiled_.end() || isFeedbackLink( link ))
+            return false;
+        if (source->processingType_ != ProcessAudio || source->voicingType_ != target->voicingType_)
+            return false;
+        if (source->isFusableSource() == false)
+            return false;
+
+        Inport* inport = target->getInport( link.rightPort_ );
+        if (inport == nullptr || inport->getNumAudioConnections() != 1)
+            return false;
+
+        int numTargets = 0;
+        for (OutportList::const_iterator it = source->outports_.begin(); it != source->outports_.end(); ++it) {
+            numTargets += (*it)->getNumConnections();
+        }
+        return numTargets == 1;
+    }
+
+
+    bool Sink::isFeedbackLink( const Link& link ) const
+    {
+        return feedbackLinkIds_.find( link.getId() ) != feedbackLinkIds_.end();
+    }
+
+
+    std::string Sink::toString() const
+    {
+        std::ostringstream os;
+        os << "order:";
+        for (const_iterator it = begin(); it != end(); ++it) {
+            os << " " << (*it)->getId() << ":" << (*it)->getLabel();
+        }
+        os << " feedback:";
+        for (LinkList::const_iterator it = feedbackLinks_.begin(); it != feedbackLinks_.end(); ++it) {
+            os << " " << it->leftModule_ << "->" << it->rightModule_;
+        }
+        os << " fused:";
+        for (LinkList::const_iterator it = fusedLinks_.begin(); it != fusedLinks_.end(); ++it) {
+            os << " " << it->leftModule_ << "->" << it->rightModule_;
+        }
+        return os.str();
+    }
+
+
+    bool Sink::contains(Module* module)
+    {
+        return compiled_.find( module ) != compiled_.end();
     }
 
 
@@ -94,6 +415,7 @@ namespace e3 {
         {
             AdsrEnvelope* adsr = dynamic_cast<AdsrEnvelope*>(module);
             adsr->makeOutputEnvelope( true );
+            outputEnvelope_ = adsr;
             return true;
         }
         return false;
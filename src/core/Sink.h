@@ -1,58 +1,150 @@
 
 #pragma once
 
+#include <string>
+#include <algorithm>
+#include <unordered_set>
 #include "JuceHeader.h"
 #include "core/Module.h"
+#include "modules/AudioInTerminal.h"
 
 
 namespace e3 {
 
     class Module;
     class Instrument;
+    class Polyphony;
+    class AdsrEnvelope;
+
+    //--------------------------------------------------------------------------
+    // class Sink
+    // Holds the modules of an Instrument in processing order.
+    // compile() sorts all modules that contribute to the AudioOutTerminal
+    // topologically. Links that close a feedback loop are cut from the sort;
+    // because an Inport keeps its value until its owner reads it, the target
+    // of a cut link receives the source signal one sample later.
+    // Finally, simple chains are fused: a source that feeds exactly one
+    // target is computed inside the target's kernel and leaves the Sink.
+    // The MIDI modules receive the voice events of each message as one batch,
+    // the output envelope receives them too, to fade out stolen voices.
+    // process() collects the stereo output of up to BlockSize frames and adds
+    // it to the channels of the AudioSampleBuffer in one pass per channel.
+    // The AudioInTerminals read from the input set with setInput().
+    //--------------------------------------------------------------------------
 
     class Sink : public ModuleList
     {
     public:
+        enum { BlockSize = 64 };
+
         Sink();
         void compile(Instrument* instrument);
+        void sort( Instrument* instrument );        // first step of compile()
+        void fuse( Instrument* instrument );        // second step, after the modules are connected
         void process(AudioSampleBuffer& audioBuffer, int startFrame, int numFrames);
+        void processVoiceEvents( Polyphony* polyphony );
 
         void setSampleRate(double sampleRate);
+        void setGain( double gain )                { gain_ = gain; }
+        void setInput( const AudioSampleBuffer* input ) { input_ = input; }
+
+        const LinkList& getFeedbackLinks() const   { return feedbackLinks_; }
+        const LinkList& getFusedLinks() const      { return fusedLinks_; }
+        const ModuleList& getEventSources() const  { return eventSources_; }
+        const ModuleList& getInputTerminals() const { return inputTerminals_; }
+        const double* getOutputLevels() const;
+        int getNumFeedbackLoops() const            { return numFeedbackLoops_; }   // number of cyclic components
+        std::string toString() const;
 
     protected:
         void reset();
+        void writeBlock( AudioSampleBuffer& audioBuffer, int startFrame, int numFrames );
         bool contains(Module* module);
         bool checkOutputEnvelope( Module* module );
 
-        double zero_                 = 0;
-        double* audioOutPointer_    = &zero_;
+        void collectModules( Instrument* instrument, Module* audioOut );
+        void findFeedbackLinks( Instrument* instrument );
+        void sortModules( Instrument* instrument );
+        void collectEventSources();
+        void collectInputTerminals();
+        void fuseModules( Instrument* instrument );
+        bool canFuse( Module* source, Module* target, const Link& link ) const;
+        bool isFeedbackLink( const Link& link ) const;
+
+        std::unordered_set< Module* > compiled_;
+        ModuleList collected_;
+        ModuleList eventSources_;
+        ModuleList inputTerminals_;
+        AdsrEnvelope* outputEnvelope_ = nullptr;
+        LinkList feedbackLinks_;
+        std::unordered_set< int > feedbackLinkIds_;
+        LinkList fusedLinks_;
+        int numFeedbackLoops_ = 0;
+
+        double gain_                 = 1;      // of the Part, see MultiTimbral
+        double zero_[2];
+        const double* audioOutPointer_ = zero_;    // left and right of the AudioOutTerminal
         int16_t frameCounter_        = 0;
         uint16_t controlRateDivisor_ = 1;
+
+        double block_[2][BlockSize];
+        const AudioSampleBuffer* input_ = nullptr;
     };
 
 
     inline void Sink::process(AudioSampleBuffer& audioBuffer, int startFrame, int numFrames)
     {
+        for (ModuleList::const_iterator it = inputTerminals_.begin(); it != inputTerminals_.end(); ++it) {
+            static_cast<AudioInTerminal*>(*it)->setInput( input_, startFrame );
+        }
+
         int lastFrame = startFrame + numFrames;
-        for (int frame = startFrame; frame < lastFrame; frame++)
+        for (int blockStart = startFrame; blockStart < lastFrame; blockStart += BlockSize)
         {
-            if (--frameCounter_ <= 0) {
-                frameCounter_ = controlRateDivisor_;
-            }
-            for (Module** m = _Myfirst; m != _Mylast; m++)
+            int blockSize = std::min<int>( BlockSize, lastFrame - blockStart );
+            for (int i = 0; i < blockSize; i++)
             {
-                if (frameCounter_ == controlRateDivisor_)
-                {
-                    if ((*m)->processingType_ & ProcessControl)
-                        (*m)->processControl();
+                if (--frameCounter_ <= 0) {
+                    frameCounter_ = controlRateDivisor_;
                 }
+                for (Module** m = _Myfirst; m != _Mylast; m++)
+                {
+                    if (frameCounter_ == controlRateDivisor_)
+                    {
+                        if ((*m)->processingType_ & ProcessControl)
+                            (*m)->processControl();
+                    }
 
-                if ((*m)->processFunction_ != nullptr)
-                    ((*m)->*(*m)->processFunction_)();
+                    if ((*m)->processFunction_ != nullptr)
+                        ((*m)->*(*m)->processFunction_)();
+                }
+                block_[0][i] = audioOutPointer_[0];
+                block_[1][i] = audioOutPointer_[1];
             }
+            writeBlock( audioBuffer, blockStart, blockSize );
+        }
+    }
+
 
-            for (int channel = audioBuffer.getNumChannels(); --channel >= 0;)  {
-                audioBuffer.addSample(channel, frame, (float)*audioOutPointer_);  // TODO: use double
+    // Channels beyond the second get the stereo pair again, a mono buffer gets the sum.
+    inline void Sink::writeBlock( AudioSampleBuffer& audioBuffer, int startFrame, int numFrames )
+    {
+        int numChannels = audioBuffer.getNumChannels();
+        if (numChannels == 1)
+        {
+            float* out  = audioBuffer.getWritePointer( 0, startFrame );
+            double gain = gain_ * 0.5;
+            for (int i = 0; i < numFrames; i++) {
+                out[i] += (float)((block_[0][i] + block_[1][i]) * gain);
+            }
+            return;
+        }
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            float* out        = audioBuffer.getWritePointer( channel, startFrame );
+            const double* in  = block_[channel & 1];
+            for (int i = 0; i < numFrames; i++) {
+                out[i] += (float)(in[i] * gain_);
             }
         }
     }
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // struct Transport
+    // Tempo and position of the host at the start of the current block, read
+    // by tempo synced modules through their Polyphony. block counts the
+    // blocks, so a module can tell how far it is into the current one.
+    //--------------------------------------------------------------------------
+
+    struct Transport
+    {
+        double bpm         = 120;
+        double ppqPosition = 0;     // quarter notes
+        bool playing       = false;
+        uint32_t block     = 0;
+    };
+
+} // namespace e3
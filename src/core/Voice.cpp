@@ -19,6 +19,8 @@ namespace e3 {
         gate_        = -1;
         tag_         = -1;
         unisonGroup_ = -1;
+        channel_     = 0;
+        pan_         = 0;
     }
 
 
@@ -15,6 +15,7 @@ namespace e3 {
             NoteOff = 1,
             NoteOn = 2,
             NoteHold = 4,
+            Fading = 8,             // stolen, fades out while a reserve voice plays the new note
         };
 
         Voice() = default;
@@ -28,7 +29,39 @@ namespace e3 {
         double gate_      = -1;
         int tag_          = -1;
         int unisonGroup_  = -1;
+        int channel_      = 0;        // MIDI channel of the note, 1-16
+        double pan_       = 0;        // -1..1, place in the unison group, see Pan
     };
     typedef std::vector< Voice > VoiceList;
 
+
+    //--------------------------------------------------------------------------
+    // struct VoiceEvent
+    // A note, pitchbend or pressure change, collected by Polyphony while it
+    // handles a MIDI message and delivered to the MIDI modules as one batch.
+    // Pitchbend, pressure and timbre apply to a single voice with MPE and
+    // polyphonic aftertouch, and to all voices if voice_ is -1.
+    // Fade tells the output envelope that the voice was stolen.
+    //--------------------------------------------------------------------------
+
+    struct VoiceEvent
+    {
+        enum Type {
+            Note      = 0,
+            Pitchbend = 1,
+            Pressure  = 2,
+            Timbre    = 3,
+            Fade      = 4
+        };
+
+        Type type_         = Note;
+        int voice_         = -1;
+        double pitch_      = -1;
+        double gate_       = -1;        // -1: legato, the gate is not changed
+        bool gateChanged_  = false;     // false if only the pitch of a sounding voice changes
+        int bend_          = 0x2000;
+        double value_      = 0;         // pressure or timbre, 0..1
+    };
+    typedef std::vector< VoiceEvent > VoiceEventList;
+
 } // namespace e3
\ No newline at end of file
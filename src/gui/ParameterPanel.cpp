@@ -2,6 +2,7 @@
 #include <e3_Trace.h>
 #include "core/Module.h"
 #include "core/Instrument.h"
+#include "core/Polyphony.h"
 #include "core/Processor.h"
 #include "gui/Style.h"
 #include "gui/CommandTarget.h"
@@ -35,6 +36,7 @@ namespace e3 {
         unisonLabel_.setText( "Unison", dontSendNotification );
         spreadLabel_.setText( "Spread", dontSendNotification );
         presetLabel_.setText( "Preset", dontSendNotification );
+        stealLabel_.setText( "Voice Stealing", dontSendNotification );
 
         nameEditor_.setName( "name" );
 
@@ -71,10 +73,12 @@ namespace e3 {
         retriggerButton_.setButtonText( "Mono/Retrigger" );
         legatoButton_.setName( "legato" );
         legatoButton_.setButtonText( "Mono/Legato" );
+        mpeButton_.setName( "mpe" );
+        mpeButton_.setButtonText( "MPE" );
 
-        Label* labels[]    = { &nameLabel_, &presetLabel_, &fileLabel_, &voicesLabel_, &unisonLabel_, &spreadLabel_ };
+        Label* labels[]    = { &nameLabel_, &presetLabel_, &fileLabel_, &voicesLabel_, &unisonLabel_, &spreadLabel_, &stealLabel_ };
         Label* editors[]   = { &nameEditor_, &voicesEditor_, &unisonEditor_, &spreadEditor_ };
-        Button* buttons1[] = { &holdButton_, &retriggerButton_, &legatoButton_,
+        Button* buttons1[] = { &holdButton_, &retriggerButton_, &legatoButton_, &mpeButton_,
                                &savePresetButton_, &addPresetButton_, &deletePresetButton_ };
         Button* buttons2[] = { &openInstrumentButton_, &newInstrumentButton_,
                                &saveInstrumentButton_, &saveInstrumentAsButton_ };
@@ -107,6 +111,14 @@ namespace e3 {
             addAndMakeVisible( buttons2[i] );
         }
 
+        stealBox_.setName( "stealPolicy" );
+        stealBox_.addItem( "Oldest", Polyphony::StealOldest + 1 );              // ids must not be 0
+        stealBox_.addItem( "Quietest", Polyphony::StealQuietest + 1 );
+        stealBox_.addItem( "Same Pitch", Polyphony::StealSamePitch + 1 );
+        stealBox_.addItem( "Lowest Priority", Polyphony::StealLowestPriority + 1 );
+        stealBox_.addListener( this );
+        addAndMakeVisible( &stealBox_ );
+
         presetBox_.setName( "selectPreset" );
         presetBox_.addListener( this );
 
@@ -145,10 +157,13 @@ namespace e3 {
         newInstrumentButton_.setBounds(    rect( l,    0, 85, 20 ).withY( t+210-o ));
         saveInstrumentAsButton_.setBounds( rect( l+95, 0, 85, 20 ).withY( t+210-o ));
 
-        t = large ? h - 160 : h - 140;
-        holdButton_.setBounds( l, t, w, 20 );
-        retriggerButton_.setBounds( l, t + 30, w, 20 );
-        legatoButton_.setBounds(    l, t + 60, w, 20 );
+        t = large ? h - 210 : h - 200;
+        holdButton_.setBounds(      l, t, w, 20 );
+        retriggerButton_.setBounds( l, t + 25, w, 20 );
+        legatoButton_.setBounds(    l, t + 50, w, 20 );
+        mpeButton_.setBounds(       l, t + 75, w, 20 );
+        stealLabel_.setBounds(      l, t + 100, w, 20 );
+        stealBox_.setBounds(        l, t + 120, w, 20 );
 
         t = h - 50;
         voicesLabel_.setBounds( l,       t, 55, 20 );
@@ -175,6 +190,8 @@ namespace e3 {
         holdButton_.setToggleState( instrument->hold_, dontSendNotification );
         retriggerButton_.setToggleState( instrument->retrigger_, dontSendNotification );
         legatoButton_.setToggleState( instrument->legato_, dontSendNotification );
+        mpeButton_.setToggleState( instrument->mpe_, dontSendNotification );
+        stealBox_.setSelectedId( instrument->stealPolicy_ + 1, dontSendNotification );
 
         voicesEditor_.setText( String(instrument->numVoices_), dontSendNotification );
         unisonEditor_.setText( String( instrument->numUnison_), dontSendNotification );
@@ -233,6 +250,12 @@ namespace e3 {
     }
 
 
+    void InstrumentParameterPanel::comboBoxChanged( ComboBox* comboBox )
+    {
+        processor_->setInstrumentAttribute( comboBox->getName().toStdString(), comboBox->getSelectedId() - 1 );
+    }
+
+
     void InstrumentParameterPanel::comboBoxChanged( CustomComboBox* )
     {
         Instrument* instrument = processor_->getInstrument();
@@ -257,7 +280,8 @@ namespace e3 {
     // class ModuleParameterPanel
     //--------------------------------------------------------------
 
-    ModuleParameterPanel::ModuleParameterPanel()
+    ModuleParameterPanel::ModuleParameterPanel( Processor* processor ) :
+        processor_( processor )
     {
         Style& style = Style::getInstance();
         Colour textColour = style.findColour( TextEditor::textColourId );
@@ -309,7 +333,7 @@ namespace e3 {
         for (ParameterSet::iterator it = parameters.moduleFirst( id ); it != parameters.moduleLast( id ); ++it)
         {
             const Parameter& p = *it;
-            ParameterStrip* strip = new ParameterStrip( r, module, &p );
+            ParameterStrip* strip = new ParameterStrip( r, processor_, module, &p );
             parameters_.add( strip );
             addAndMakeVisible( strip );
             r.translate( 0, 30 );
@@ -331,7 +355,8 @@ namespace e3 {
     // class ParameterStrip
     //--------------------------------------------------------------
 
-    ParameterStrip::ParameterStrip( const Rectangle<int>& bounds, Module* module, const Parameter* parameter ) :
+    ParameterStrip::ParameterStrip( const Rectangle<int>& bounds, Processor* processor, Module* module, const Parameter* parameter ) :
+        processor_(processor),
         module_(module),
         parameter_(parameter)
     {
@@ -380,16 +405,18 @@ namespace e3 {
     void ParameterStrip::sliderValueChanged( Slider* slider )
     {
         ASSERT( slider == &slider_ );
-        parameter_->value_ = slider->getValue();
-        module_->setParameter( *parameter_ );
+        double previousValue = parameter_->value_;
+        parameter_->value_   = slider->getValue();
+        processor_->queueParameter( *parameter_, previousValue );
     }
 
 
     void ParameterStrip::buttonClicked( Button* button )
     {
         ASSERT( button == &button_ );
-        parameter_->value_ = button->getToggleState();
-        module_->setParameter( *parameter_ );
+        double previousValue = parameter_->value_;
+        parameter_->value_   = button->getToggleState();
+        processor_->queueParameter( *parameter_, previousValue );
     }
 
 
@@ -400,7 +427,7 @@ namespace e3 {
     ParameterPanel::ParameterPanel( Processor* processor )
     {
         instrumentPanel_ = new InstrumentParameterPanel( processor );
-        modulePanel_     = new ModuleParameterPanel();
+        modulePanel_     = new ModuleParameterPanel( processor );
 
         addChildComponent( instrumentPanel_ );
         addChildComponent( modulePanel_ );
@@ -20,6 +20,7 @@ namespace e3
     class InstrumentParameterPanel : public Component, 
                                      public Label::Listener,
                                      public Button::Listener,
+                                     public ComboBox::Listener,
                                      public CustomComboBox::Listener
     { 
     public:
@@ -31,6 +32,7 @@ namespace e3
 
         void labelTextChanged( Label* label ) override;
         void buttonClicked( Button* button ) override;
+        void comboBoxChanged( ComboBox* comboBox ) override;
         void comboBoxChanged( CustomComboBox* comboBox ) override;
         void comboBoxTextChanged( CustomComboBox* comboBox ) override;
 
@@ -43,6 +45,7 @@ namespace e3
         Label voicesLabel_;
         Label unisonLabel_;
         Label spreadLabel_;
+        Label stealLabel_;
 
         Label nameEditor_;
         NumericLabel voicesEditor_;
@@ -61,6 +64,8 @@ namespace e3
         ToggleButton holdButton_;
         ToggleButton retriggerButton_;
         ToggleButton legatoButton_;
+        ToggleButton mpeButton_;
+        ComboBox stealBox_;
 
         Label presetLabel_;
         CustomComboBox presetBox_;
@@ -72,7 +77,7 @@ namespace e3
     class ModuleParameterPanel : public Component, public Label::Listener
     {
     public:
-        ModuleParameterPanel();
+        ModuleParameterPanel( Processor* processor );
 
         void resized() override;
         void paint( Graphics& g ) override;
@@ -84,6 +89,7 @@ namespace e3
 
         Label headerLabel_;
         OwnedArray<ParameterStrip> parameters_;
+        Processor* processor_;
     };
 
 
@@ -94,7 +100,7 @@ namespace e3
     class ParameterStrip : public Component, public Slider::Listener, public Button::Listener
     {
     public:
-        ParameterStrip( const Rectangle<int>& bounds, Module* module, const Parameter* parameter );
+        ParameterStrip( const Rectangle<int>& bounds, Processor* processor, Module* module, const Parameter* parameter );
 
         void sliderValueChanged( Slider* slider ) override;
         void buttonClicked( Button* button ) override;
@@ -109,6 +115,7 @@ namespace e3
         //void addControl( const Rectangle<int> bounds, Module* module );
         //CMouseEventResult showCtrlDialog( const CPoint& pos );
 
+        Processor* processor_;
         Module* module_;
         const Parameter* parameter_;
         Label label_;
@@ -1,5 +1,7 @@
 
 #include <cmath>
+#include <e3_Exception.h>
+#include "modules/SineOscillator.h"
 #include "modules/AdsrEnvelope.h"
 
 
@@ -13,10 +15,10 @@ namespace e3 {
         (ProcessingType)(ProcessAudio | ProcessControl) )
     {
         addInport( 0, "In", &audioInport_ );
-        addInport( 1, "Gate", &gateInport_ );
+        addInport( 1, "Gate", &gateInport_, &eventSetter< AdsrEnvelope, &AdsrEnvelope::setGate > );
         addOutport( 0, "Out", &audioOutport_, PortTypeAudio );
 
-        processFunction_ = static_cast<ProcessFunctionPointer>(&AdsrEnvelope::processAudio);
+        updatePorts();
     }
 
 
@@ -53,14 +55,34 @@ namespace e3 {
     {
         Module::initData();
 
-        value_    = valueBuffer_.resize( numVoices_, 0 );
-        state_    = stateBuffer_.resize( numVoices_, 0 );
-        velocity_ = velocityBuffer_.resize( numVoices_, 0 );
+        value_    = allocate< double >( numVoices_, 0 );
+        state_    = allocate< int >( numVoices_, 0 );
+        velocity_ = allocate< double >( numVoices_, 0 );
+        fadeStep_ = allocate< double >( numVoices_, 0 );
 
         audioInportPointer_ = audioInport_.getAudioBuffer();
     }
 
 
+    void AdsrEnvelope::updatePorts()
+    {
+        processFunction_ = ProcessFunctionSelector< Kernels >::select( mono_ );
+    }
+
+
+    bool AdsrEnvelope::fuseSource( Module* source, const Link& link )
+    {
+        if (link.rightPort_ == ParamAudioIn && mono_ == false && source->moduleType_ == ModuleTypeSineOscillator)
+        {
+            fusedSource_     = source;
+            fusedModulation_ = source->getOutport( link.leftPort_ )->getAudioModulation();
+            processFunction_ = static_cast<ProcessFunctionPointer>(&AdsrEnvelope::processAudioFused<SineOscillator>);
+            return true;
+        }
+        return false;
+    }
+
+
     void AdsrEnvelope::setSampleRate( double sampleRate )
     {
         Module::setSampleRate( sampleRate );
@@ -77,13 +99,7 @@ namespace e3 {
 
         switch (paramId)
         {
-        case ParamGate:
-            if (voice > -1)
-            {
-                double velo = value * modulation + (1 - modulation);
-                value > 0 ? keyOn( velo, voice ) : keyOff( voice );
-                break;
-            }
+        case ParamGate:    if (voice > -1) setGate( value, modulation, voice ); break;
         case ParamAttack:  attackTime_   = value; calculateAttackTime(); break;
         case ParamDecay:   decayTime_    = value; calculateDecayTime(); break;
         case ParamSustain: sustainLevel_ = value; calculateDecayTime(); break;
@@ -92,6 +108,27 @@ namespace e3 {
     }
 
 
+    void AdsrEnvelope::setGate( double value, double modulation, int voice )
+    {
+        ASSERT( voice >= 0 && voice < numVoices_ );
+
+        double velo = value * modulation + (1 - modulation);
+        value > 0 ? keyOn( velo, voice ) : keyOff( voice );
+    }
+
+
+    // The output envelope fades out the voices stolen by Polyphony.
+    void AdsrEnvelope::processVoiceEvents( const VoiceEventList& events )
+    {
+        for (VoiceEventList::const_iterator e = events.begin(); e != events.end(); ++e)
+        {
+            if (e->type_ == VoiceEvent::Fade && e->voice_ > -1 && e->voice_ < numVoices_) {
+                fadeOut( e->voice_ );
+            }
+        }
+    }
+
+
     void AdsrEnvelope::keyOn( double amplitude, int voice )
     {
         value_[voice]    = 0;
@@ -106,6 +143,13 @@ namespace e3 {
     }
 
 
+    void AdsrEnvelope::fadeOut( int voice )
+    {
+        fadeStep_[voice] = value_[voice] / polyphony_->getFadeSamples();
+        state_[voice]    = (value_[voice] > 0) ? StateFade : StateDone;
+    }
+
+
     void AdsrEnvelope::calculateAttackTime()
     {
         double numSamples = sampleRate_ * attackTime_;
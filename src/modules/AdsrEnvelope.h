@@ -16,10 +16,26 @@ namespace e3 {
         ParameterSet& getDefaultParameters() const override;
         void initData() override;
 
-        void processAudio() throw();
+        template< bool Mono > void processAudio() throw();
+
+        struct Kernels
+        {
+            template< bool Mono > static ProcessFunctionPointer get()
+            {
+                return static_cast<ProcessFunctionPointer>(&AdsrEnvelope::processAudio< Mono >);
+            }
+        };
+
+        // Fused kernel: the source feeding the audio inport is computed in place.
+        template< class Source > void processAudioFused() throw();
+
+        bool fuseSource( Module* source, const Link& link ) override;
 
         void setParameter( int paramId, double value, double modulation=0.f, int voice=-1 ) override;
+        void setGate( double value, double modulation, int voice );
+        void processVoiceEvents( const VoiceEventList& events ) override;
         void makeOutputEnvelope( bool value ) { isOutputEnvelope_ = value; }
+        const double* getLevels() const       { return value_; }
 
         enum ParamId {                 
             ParamAudioIn  = 0,         // TODO: what's the use?
@@ -32,8 +48,12 @@ namespace e3 {
         };
 
     protected:
+        void updatePorts() override;
+        double tick( int_fast32_t voice, double input ) throw();
+
         void keyOn( double amplitude, int voice );
         void keyOff( int voice );
+        void fadeOut( int voice );
 
         void setSampleRate( double sampleRate );
 
@@ -42,8 +62,6 @@ namespace e3 {
         void calculateReleaseTime();
 
 
-        std::string debugLabel_ = "AdsrEnvelope";
-
         double attackTime_    = 0;
         double attackCoeff_   = 0;
         double attackOffset_  = 0;
@@ -63,11 +81,10 @@ namespace e3 {
 
         bool isOutputEnvelope_ = false;
 
-        Buffer<double> valueBuffer_, velocityBuffer_;
-        double *value_, *velocity_;
-
-        Buffer<int> stateBuffer_;
-        int* state_;
+        double* value_    = nullptr;
+        double* velocity_ = nullptr;
+        double* fadeStep_ = nullptr;
+        int* state_       = nullptr;
 
         Inport audioInport_;
         Outport audioOutport_;
@@ -79,67 +96,105 @@ namespace e3 {
             StateDecay,
             StateSustain,
             StateRelease,
+            StateFade,
             StateDone
         };
     };
 
-    inline void AdsrEnvelope::processAudio() throw()
+    __forceinline double AdsrEnvelope::tick( int_fast32_t v, double input ) throw()
     {
-        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
-
-        for (int_fast32_t i = 0; i < maxVoices; i++)
+        __assume(state_[v] <= 5);
+        switch (state_[v])
         {
-            int_fast32_t v         = polyphony_->soundingVoices_[i];
-            double input           = audioInportPointer_[v];
-            audioInportPointer_[v] = 0;
-
-            __assume(state_[v] <= 4);
-            switch (state_[v])
-            {
-            case StateAttack:
+        case StateAttack:
+        {
+            value_[v] = attackOffset_ + value_[v] * attackCoeff_;
+            if (value_[v] >= 1.0)
             {
-                value_[v] = attackOffset_ + value_[v] * attackCoeff_;
-                if (value_[v] >= 1.0)
-                {
-                    value_[v] = 1.0;
-                    state_[v]  = StateDecay;
-                }
-                break;
+                value_[v] = 1.0;
+                state_[v]  = StateDecay;
             }
-            case StateDecay:
-            {
-                value_[v] = decayOffset_ + value_[v] * decayCoeff_;
+            break;
+        }
+        case StateDecay:
+        {
+            value_[v] = decayOffset_ + value_[v] * decayCoeff_;
 
-                if (value_[v] <= sustainLevel_)
-                {
-                    value_[v] = sustainLevel_;
-                    state_[v] = StateSustain;
-                }
-                break;
-            }
-            case StateSustain:
+            if (value_[v] <= sustainLevel_)
             {
                 value_[v] = sustainLevel_;
-                break;
+                state_[v] = StateSustain;
             }
-            case StateRelease:
-            {
-                value_[v] = releaseOffset_ + value_[v] * releaseCoeff_;
+            break;
+        }
+        case StateSustain:
+        {
+            value_[v] = sustainLevel_;
+            break;
+        }
+        case StateRelease:
+        {
+            value_[v] = releaseOffset_ + value_[v] * releaseCoeff_;
 
-                if (value_[v] <= 0.0)
-                {
-                    value_[v] = 0.0;
-                    state_[v] = StateDone;
+            if (value_[v] <= 0.0)
+            {
+                value_[v] = 0.0;
+                state_[v] = StateDone;
 
-                    if (isOutputEnvelope_) {
-                        polyphony_->endVoice( v );
-                    }
+                if (isOutputEnvelope_) {
+                    polyphony_->endVoice( v );
                 }
-                break;
             }
+            break;
+        }
+        case StateFade:
+        {
+            value_[v] -= fadeStep_[v];
+
+            if (value_[v] <= 0.0)
+            {
+                value_[v] = 0.0;
+                state_[v] = StateDone;
+
+                if (isOutputEnvelope_) {
+                    polyphony_->endVoice( v );
+                }
             }
+            break;
+        }
+        }
+        return input * value_[v] * velocity_[v];
+    }
+
+
+    template< bool Mono >
+    inline void AdsrEnvelope::processAudio() throw()
+    {
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v         = Mono ? 0 : polyphony_->soundingVoices_[i];
+            double input           = audioInportPointer_[v];
+            audioInportPointer_[v] = 0;
+
+            audioOutport_.putAudio( tick( v, input ), v );
+        }
+    }
+
+
+    template< class Source >
+    inline void AdsrEnvelope::processAudioFused() throw()
+    {
+        Source* source         = static_cast<Source*>(fusedSource_);
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = polyphony_->soundingVoices_[i];
+            double input   = source->tick( v ) * fusedModulation_[v];
 
-            audioOutport_.putAudio( input * value_[v] * velocity_[v], v );
+            audioOutport_.putAudio( tick( v, input ), v );
         }
     }
 
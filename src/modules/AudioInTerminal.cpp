@@ -0,0 +1,57 @@
+
+#include "modules/AudioInTerminal.h"
+
+
+namespace e3 {
+
+    AudioInTerminal::AudioInTerminal() : Module(
+        ModuleTypeAudioInTerminal,
+        "AudioIn",
+        Monophonic,
+        ProcessAudio )
+    {
+        addOutport( 0, "Left", &leftOutport_, PortTypeAudio );
+        addOutport( 1, "Right", &rightOutport_, PortTypeAudio );
+        processFunction_ = static_cast< ProcessFunctionPointer >(&AudioInTerminal::processAudio);
+    }
+
+
+    ParameterSet& AudioInTerminal::getDefaultParameters() const
+    {
+        static ParameterSet set;
+        set.clear();
+
+        const Parameter& paramGain = set.addModuleParameter( ParamGain, id_, "Gain", ControlSlider, 1 );
+        paramGain.numberFormat_ = NumberDecibel;
+        paramGain.unit_ = "db";
+
+        set.addModuleParameter( ParamSidechain, id_, "Sidechain", ControlCheckbox, 0 );
+
+        return set;
+    }
+
+
+    void AudioInTerminal::setParameter( int paramId, double value, double, int )
+    {
+        switch (paramId) {
+        case ParamGain:      gain_ = value; break;
+        case ParamSidechain: firstChannel_ = (value > 0.5) ? 2 : 0; break;
+        }
+    }
+
+
+    // No input, or fewer channels than the terminal reads: silence.
+    void AudioInTerminal::setInput( const AudioSampleBuffer* input, int startFrame )
+    {
+        left_  = nullptr;
+        right_ = nullptr;
+
+        if (input != nullptr && firstChannel_ < input->getNumChannels())
+        {
+            left_  = input->getReadPointer( firstChannel_, startFrame );
+            right_ = (firstChannel_ + 1 < input->getNumChannels()) ?
+                input->getReadPointer( firstChannel_ + 1, startFrame ) : left_;
+        }
+    }
+
+} // namespace e3
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include "JuceHeader.h"
+#include "core/Port.h"
+#include "core/Module.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class AudioInTerminal
+    // The audio input of the host as a source in the graph, e.g. to use an
+    // instrument as an effect or as the carrier of a vocoder. The terminal is
+    // monophonic, polyphonic targets get the input in every voice.
+    // Sink points the terminal to the input buffer before each run, the
+    // kernel reads the samples from there. With Sidechain set, the terminal
+    // reads the channels 3 and 4. A mono input feeds both outports.
+    //--------------------------------------------------------------------------
+
+    class AudioInTerminal : public Module
+    {
+    public:
+        AudioInTerminal();
+
+        ParameterSet& getDefaultParameters() const override;
+        void setParameter( int paramId, double value, double modulation = 0, int voice = -1 ) override;
+
+        // Audio thread, see Sink::process()
+        void setInput( const AudioSampleBuffer* input, int startFrame );
+
+        void processAudio() throw();
+
+        enum ParamId {
+            ParamGain      = 0,
+            ParamSidechain = 1
+        };
+
+    protected:
+        Outport leftOutport_;
+        Outport rightOutport_;
+
+        const float* left_  = nullptr;
+        const float* right_ = nullptr;
+        double gain_        = 1;
+        int firstChannel_   = 0;
+    };
+
+
+    inline void AudioInTerminal::processAudio() throw()
+    {
+        if (left_ == nullptr) return;
+
+        leftOutport_.putAudio( *left_++ * gain_ );
+        rightOutport_.putAudio( *right_++ * gain_ );
+    }
+
+} // namespace e3
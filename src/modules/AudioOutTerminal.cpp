@@ -1,5 +1,4 @@
 
-
 #include "modules/AudioOutTerminal.h"
 
 
@@ -11,8 +10,11 @@ namespace e3 {
         Monophonic,
         ProcessAudio) 
     {
-        addInport(0, "In", &audioInport_);
-        processFunction_ = static_cast< ProcessFunctionPointer >(&AudioOutTerminal::processAudio);
+        output_[0] = output_[1] = 0;
+
+        addInport(0, "Left", &leftInport_);
+        addInport(1, "Right", &rightInport_);
+        processFunction_ = static_cast< ProcessFunctionPointer >(&AudioOutTerminal::processAudio< false >);
     }
 
 
@@ -34,25 +36,30 @@ namespace e3 {
         Module::initData();
 
         ASSERT(numVoices_ == 1);
-        ASSERT( audioInport_.getNumVoices() == 1 );
-        audioInportPointer_ = audioInport_.getAudioBuffer();
+        ASSERT( leftInport_.getNumVoices() == 1 );
+        leftInportPointer_  = leftInport_.getAudioBuffer();
+        rightInportPointer_ = rightInport_.getAudioBuffer();
+        output_[0] = output_[1] = 0;
     }
 
 
-    void AudioOutTerminal::setParameter(int paramId, double value, double, int)
+    // Instruments made before the Right inport existed stay mono.
+    void AudioOutTerminal::updatePorts()
     {
-        switch (paramId) {
-        case ParamVolume: volume_ = value; break;
-        }
+        bool stereo = rightInport_.getNumAudioConnections() > 0;
+
+        processFunction_ = stereo ?
+            static_cast< ProcessFunctionPointer >(&AudioOutTerminal::processAudio< true >) :
+            static_cast< ProcessFunctionPointer >(&AudioOutTerminal::processAudio< false >);
     }
 
 
-    void AudioOutTerminal::processAudio() throw()
+    void AudioOutTerminal::setParameter(int paramId, double value, double, int)
     {
-        double input = *audioInportPointer_;
-        *audioInportPointer_ = 0.0f;
-        value_ = std::max<double>(-1, std::min<double>(1, input * volume_));
+        switch (paramId) {
+        case ParamVolume: volume_ = value; break;
+        }
     }
 
-
 } // namespace e3
+
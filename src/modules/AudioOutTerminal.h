@@ -1,4 +1,3 @@
-
 #pragma once
 
 #include <string>
@@ -8,6 +7,13 @@
 
 namespace e3 {
 
+    //--------------------------------------------------------------------------
+    // class AudioOutTerminal
+    // The stereo output of an instrument. Sink reads output_ every frame.
+    // While nothing is connected to the Right inport, the terminal is mono
+    // and both channels get the Left input.
+    //--------------------------------------------------------------------------
+
     class AudioOutTerminal : public Module 
     {
     public:
@@ -16,21 +22,47 @@ namespace e3 {
 
         ParameterSet& getDefaultParameters() const override;
         void initData() override;
+        void updatePorts() override;
         void setParameter(int paramId, double value, double modulation = 0, int voice = -1) override;
 
-        void processAudio() throw();
+        template< bool Stereo > void processAudio() throw();
 
         enum {
             ParamVolume,
         };
 
-        std::string debugLabel_ = "AudioOutTerminal";
-        double value_ = 0;
+        enum {
+            NumChannels = 2
+        };
+
+        double output_[NumChannels];
 
     protected:
-        Inport audioInport_;
+        Inport leftInport_;
+        Inport rightInport_;
 
         double volume_ = 0.1;
-        double* audioInportPointer_ = nullptr;
+        double* leftInportPointer_  = nullptr;
+        double* rightInportPointer_ = nullptr;
     };
+
+
+    template< bool Stereo >
+    inline void AudioOutTerminal::processAudio() throw()
+    {
+        double left = *leftInportPointer_;
+        *leftInportPointer_ = 0;
+        output_[0] = std::max<double>( -1, std::min<double>( 1, left * volume_ ) );
+
+        if (Stereo) {
+            double right = *rightInportPointer_;
+            *rightInportPointer_ = 0;
+            output_[1] = std::max<double>( -1, std::min<double>( 1, right * volume_ ) );
+        }
+        else {
+            output_[1] = output_[0];
+        }
+    }
 } // namespace e3
+
+
@@ -45,7 +45,8 @@ namespace e3 {
         ASSERT( audioInport_.getNumVoices() > 0 );
         ASSERT( audioOutport_.getNumVoices() > 0 );
 
-        audioInportPointer_ = audioInport_.getAudioBuffer();
+        audioInportPointer_  = audioInport_.getAudioBuffer();
+        cursorBufferPointer_ = allocate< uint_fast32_t >( numVoices_, 0 );
 
         updateBuffer();
     }
@@ -72,7 +73,6 @@ namespace e3 {
     {
         bufferSize_          = (uint_fast32_t)sampleRate_;
         delayBufferPointer_  = delayBuffer_.resize( numVoices_ * bufferSize_ );
-        cursorBufferPointer_ = cursorBuffer_.resize( numVoices_ );
     }
 
 
@@ -20,14 +20,14 @@ namespace e3 {
         void setParameter(int paramId, double value, double modulation=0.f, int voice=-1) override;
         void setSampleRate(double sampleRate) override;
 
+        size_t getBufferSize() const    { return numVoices_ * bufferSize_; }     // frames of all voices
+
         enum ParamId {
             ParamDelaytime = 1,
             ParamFeedback  = 2,
             ParamGain      = 3
         };
 
-        std::string debugLabel_ = "Delay";
-
     protected:
         void updateBuffer();
 
@@ -36,7 +36,6 @@ namespace e3 {
         uint_fast32_t delayTime_  = 0;
         uint_fast32_t bufferSize_ = 0;
 
-        Buffer<uint_fast32_t> cursorBuffer_;
         uint_fast32_t* cursorBufferPointer_ = nullptr;
         
         Buffer< double > delayBuffer_;
@@ -0,0 +1,208 @@
+
+#include <cmath>
+#include <e3_Exception.h>
+#include "core/Polyphony.h"
+#include "modules/Lfo.h"
+
+
+namespace e3 {
+
+    Lfo::Lfo() : Module(
+        ModuleTypeLfo,
+        "LFO",
+        Polyphonic,
+        (ProcessingType)(ProcessEvent | ProcessControl | ProcessAudio) )
+    {
+        addInport( 0, "Amp", &ampInport_, &eventSetter< Lfo, &Lfo::setAmplitude > );
+        addOutport( 0, "Out", &eventOutport_, PortTypeEvent );
+        addOutport( 1, "Audio", &audioOutport_, PortTypeAudio );
+    }
+
+
+    ParameterSet& Lfo::getDefaultParameters() const
+    {
+        static ParameterSet set;
+        set.clear();
+
+        const Parameter& paramShape = set.addModuleParameter( ParamShape, id_, "Shape", ControlNumEdit, ShapeSine );
+        paramShape.valueShaper_ = { 0, 4, 4 };
+        paramShape.numberFormat_ = NumberInt;
+
+        const Parameter& paramRate = set.addModuleParameter( ParamRate, id_, "Rate", ControlSlider, 1 );
+        paramRate.valueShaper_ = { 0.01, 50, 1000, 12 };
+        paramRate.unit_ = "Hz";
+        paramRate.numberFormat_ = NumberFloat;
+
+        set.addModuleParameter( ParamSync, id_, "Sync", ControlCheckbox, 0 );
+
+        const Parameter& paramBeats = set.addModuleParameter( ParamBeats, id_, "Beats", ControlSlider, 1 );
+        paramBeats.valueShaper_ = { 0.125, 16, 127 };
+        paramBeats.numberFormat_ = NumberFloat;
+
+        set.addModuleParameter( ParamGlobal, id_, "Global", ControlCheckbox, 0 );
+        set.addModuleParameter( ParamRetrigger, id_, "Retrigger", ControlCheckbox, 1 );
+
+        return set;
+    }
+
+
+    void Lfo::initData()
+    {
+        Module::initData();
+
+        phase_  = allocate< double >( numVoices_, 0 );
+        hold_   = allocate< double >( numVoices_, 0 );
+        amp_    = allocate< double >( numVoices_, 1 );
+        target_ = allocate< double >( numVoices_, 0 );
+        value_  = allocate< double >( numVoices_, 0 );
+        step_   = allocate< double >( numVoices_, 0 );
+    }
+
+
+    // The kernel runs only for audio targets, event targets cost nothing per sample.
+    void Lfo::updatePorts()
+    {
+        processFunction_ = (audioOutport_.getNumAudioConnections() > 0) ?
+            static_cast<ProcessFunctionPointer>(&Lfo::processAudio) : nullptr;
+    }
+
+
+    void Lfo::setSampleRate( double sampleRate )
+    {
+        Module::setSampleRate( sampleRate );
+        controlPeriod_ = std::max<int>( 1, (int)(sampleRate_ / INITIAL_CONTROLRATE) );
+    }
+
+
+    void Lfo::setParameter( int paramId, double value, double modulation, int voice )
+    {
+        switch (paramId)
+        {
+        case ParamAmplitude: if (voice >= 0) setAmplitude( value, modulation, voice ); break;
+        case ParamShape:     shape_     = (Shape)std::max<int>( 0, std::min<int>( ShapeSampleAndHold, (int)value ) ); break;
+        case ParamRate:      rate_      = value; break;
+        case ParamSync:      sync_      = value > 0.5; break;
+        case ParamBeats:     beats_     = std::max<double>( 0.001, value ); break;
+        case ParamGlobal:    global_    = value > 0.5; break;
+        case ParamRetrigger: retrigger_ = value > 0.5; break;
+        }
+    }
+
+
+    void Lfo::setAmplitude( double value, double modulation, int voice )
+    {
+        voice = std::min<int>( numVoices_ - 1, voice );
+        amp_[voice] = value * modulation;
+    }
+
+
+    void Lfo::processVoiceEvents( const VoiceEventList& events )
+    {
+        if (retrigger_ == false) return;
+
+        for (VoiceEventList::const_iterator e = events.begin(); e != events.end(); ++e)
+        {
+            if (e->type_ == VoiceEvent::Note && e->gateChanged_ && e->gate_ > 0 && e->voice_ < numVoices_)
+            {
+                if (global_) {
+                    globalPhase_ = 0;
+                    getShape( 0, globalHold_, true );
+                }
+                else {      // the voice starts at the start of the shape, not where its last note was
+                    int v      = e->voice_;
+                    phase_[v]  = 0;
+                    target_[v] = value_[v] = getShape( 0, hold_[v], true ) * amp_[v];
+                    step_[v]   = 0;
+                }
+            }
+        }
+    }
+
+
+    // Phase increment per control tick
+    double Lfo::getIncrement() const
+    {
+        double freq = rate_;
+        if (sync_) {
+            freq = polyphony_->transport_.bpm / (60 * beats_);
+        }
+        return freq * controlPeriod_ / sampleRate_;
+    }
+
+
+    double Lfo::getShape( double phase, double& hold, bool wrapped )
+    {
+        switch (shape_)
+        {
+        case ShapeTriangle: return 1 - 4 * fabs( phase - 0.5 );
+        case ShapeSaw:      return 2 * phase - 1;
+        case ShapeSquare:   return phase < 0.5 ? 1 : -1;
+        case ShapeSampleAndHold:
+            if (wrapped) {
+                random_ = random_ * 1664525 + 1013904223;   // no rand() on the audio thread
+                hold    = (random_ >> 8) * (2.0 / 16777216.0) - 1;
+            }
+            return hold;
+        default:            return sin( TWO_PI * phase );
+        }
+    }
+
+
+    double Lfo::advance( double& phase, double& hold, double increment )
+    {
+        phase += increment;
+        bool wrapped = phase >= 1;
+        if (wrapped) {
+            phase -= floor( phase );
+        }
+        return getShape( phase, hold, wrapped );
+    }
+
+
+    void Lfo::processControl() throw()
+    {
+        const Transport& transport = polyphony_->transport_;
+        if (block_ != transport.block) {
+            block_        = transport.block;
+            blockSamples_ = 0;
+        }
+        double increment = getIncrement();
+        double shared    = 0;
+
+        if (global_)
+        {
+            if (sync_ && transport.playing)     // the song position decides the phase
+            {
+                double ppq   = transport.ppqPosition + blockSamples_ * transport.bpm / (60 * sampleRate_);
+                double phase = ppq / beats_ - floor( ppq / beats_ );
+                bool wrapped = phase < globalPhase_;
+                globalPhase_ = phase;
+                shared       = getShape( phase, globalHold_, wrapped );
+            }
+            else {
+                shared = advance( globalPhase_, globalHold_, increment );
+            }
+        }
+        blockSamples_ += controlPeriod_;
+
+        bool hasEvents = eventOutport_.getNumEventConnections() > 0;
+        bool hasAudio  = processFunction_ != nullptr;
+
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = mono_ ? 0 : polyphony_->soundingVoices_[i];
+            double value   = global_ ? shared : advance( phase_[v], hold_[v], increment );
+            value         *= amp_[v];
+            target_[v]     = value;
+
+            if (hasEvents) {
+                eventOutport_.putEvent( value, v );
+            }
+            if (hasAudio) {
+                step_[v] = (value - value_[v]) / controlPeriod_;
+            }
+        }
+    }
+
+} // namespace e3
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include "core/Module.h"
+#include "core/Polyphony.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class Lfo
+    // Low frequency oscillator computed in processControl(), at control rate.
+    // The Out outport sends the value as event to its targets on every control
+    // tick. Only while the Audio outport is connected, a kernel runs at audio
+    // rate and ramps linearly from the last value to the current one.
+    // With Global set all voices share one phase, else every voice runs its
+    // own, and Retrigger restarts the phase with each note. Synced to the host
+    // the cycle lasts Beats quarter notes, and the shared phase follows the
+    // song position while the host plays.
+    //--------------------------------------------------------------------------
+
+    class Lfo : public Module
+    {
+    public:
+        Lfo();
+
+        ParameterSet& getDefaultParameters() const override;
+        void initData() override;
+        void updatePorts() override;
+        void processControl() throw() override;
+        void processVoiceEvents( const VoiceEventList& events ) override;
+
+        void setParameter( int paramId, double value, double modulation = 0.f, int voice = -1 ) override;
+        void setAmplitude( double value, double modulation, int voice );
+
+        void processAudio() throw();
+        double getValue( int voice ) const          { return target_[voice]; }
+
+        enum ParamId {
+            ParamAmplitude = 0,         // the Amp inport
+            ParamShape     = 1,
+            ParamRate      = 2,
+            ParamSync      = 3,
+            ParamBeats     = 4,
+            ParamGlobal    = 5,
+            ParamRetrigger = 6
+        };
+
+        enum Shape {
+            ShapeSine         = 0,
+            ShapeTriangle     = 1,
+            ShapeSaw          = 2,
+            ShapeSquare       = 3,
+            ShapeSampleAndHold = 4
+        };
+
+    protected:
+        void setSampleRate( double sampleRate ) override;
+        double getIncrement() const;
+        double getShape( double phase, double& hold, bool wrapped );
+        double advance( double& phase, double& hold, double increment );
+
+        Shape shape_      = ShapeSine;
+        double rate_      = 1;          // Hz
+        double beats_     = 1;          // quarter notes per cycle
+        bool sync_        = false;
+        bool global_      = false;
+        bool retrigger_   = true;
+        int controlPeriod_ = 1;         // samples per control tick, see Sink::setSampleRate()
+        uint32_t random_  = 1;
+
+        double globalPhase_ = 0;
+        double globalHold_  = 0;
+        uint32_t block_     = 0;        // the Transport block the ticks are counted for
+        int blockSamples_   = 0;
+
+        double* phase_  = nullptr;
+        double* hold_   = nullptr;
+        double* amp_    = nullptr;
+        double* target_ = nullptr;      // value of the last control tick
+        double* value_  = nullptr;      // audio ramp towards target_
+        double* step_   = nullptr;
+
+        Inport ampInport_;
+        Outport eventOutport_;
+        Outport audioOutport_;
+    };
+
+
+    inline void Lfo::processAudio() throw()
+    {
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = mono_ ? 0 : polyphony_->soundingVoices_[i];
+            value_[v] += step_[v];
+            audioOutport_.putAudio( value_[v], v );
+        }
+    }
+
+} // namespace e3
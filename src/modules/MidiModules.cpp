@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <e3_Math.h>
 #include "core/Polyphony.h"
 #include "modules/MidiModules.h"
@@ -22,27 +23,13 @@ namespace e3 {
     }
 
     
-    void MidiGate::connectSignals()
+    void MidiGate::processVoiceEvents( const VoiceEventList& events )
     {
-        if (polyphony_) {
-            polyphony_->midiGateSignal.Connect( this, &MidiGate::onMidiGate );
-        }
-    }
-
-
-    void MidiGate::disconnectSignals()
-    {
-        if (polyphony_) {
-            if (polyphony_->midiGateSignal.Empty() == false)
-                polyphony_->midiGateSignal.Disconnect( this, &MidiGate::onMidiGate );
-        }
-    }
-
-
-    void MidiGate::onMidiGate( double gate, int voice )
-    {
-        if (gate > -1) {
-            gateOutport_.putEvent( gate, voice );
+        for (VoiceEventList::const_iterator e = events.begin(); e != events.end(); ++e)
+        {
+            if (e->type_ == VoiceEvent::Note && e->gateChanged_ && e->gate_ > -1) {
+                gateOutport_.putEvent( e->gate_, e->voice_ );
+            }
         }
     }
 
@@ -87,38 +74,22 @@ namespace e3 {
         const Parameter& paramAuto = set.addModuleParameter( ParamGlideAuto, id_, "Portamento Auto", ControlCheckbox, 0 );
         paramAuto.valueShaper_ = { 0, 1 };
 
+        const Parameter& paramNoteBend = set.addModuleParameter( ParamNoteBendRange, id_, "Note BendRange", ControlSlider, 48 );
+        paramNoteBend.valueShaper_ = { 0, 96, 96 };
+
         return set;
     }
     
 
-    void MidiFrequency::connectSignals()
-    {
-        if (polyphony_)
-        {
-            polyphony_->midiNoteSignal.Connect( this, &MidiFrequency::onMidiNote );
-            polyphony_->midiPitchbendSignal.Connect( this, &MidiFrequency::onMidiPitchbend );
-        }
-    }
-
-
-    void MidiFrequency::disconnectSignals()
-    {
-        if (polyphony_) {
-            if (polyphony_->midiNoteSignal.Empty() == false)
-                polyphony_->midiNoteSignal.Disconnect( this, &MidiFrequency::onMidiNote );
-            if (polyphony_->midiPitchSignal.Empty() == false)
-                polyphony_->midiPitchbendSignal.Disconnect( this, &MidiFrequency::onMidiPitchbend );
-        }
-    }
-
-
     void MidiFrequency::initData()
     {
         Module::initData();
 
-        glideDelta_   = glideDeltaBuffer_.resize( numVoices_ );
-        glideTarget_  = glideTargetBuffer_.resize( numVoices_ );
-        freq_         = freqBuffer_.resize( numVoices_ );
+        glideDelta_   = allocate< double >( numVoices_ );
+        glideTarget_  = allocate< double >( numVoices_ );
+        freq_         = allocate< double >( numVoices_ );
+        noteBend_     = allocate< double >( numVoices_ );
+        bendFactor_   = allocate< double >( numVoices_, 1.0 );
     }
 
 
@@ -126,9 +97,31 @@ namespace e3 {
     {
         switch (paramId)
         {
-        case ParamBendRange: bendRange_ = (int)value;           break;
-        case ParamGlideTime: setGlideTime( value );             break;
-        case ParamGlideAuto: glideAuto_ = value ? true : false; break;
+        case ParamBendRange:     bendRange_ = (int)value;     bendChanged_ = true; break;
+        case ParamGlideTime:     setGlideTime( value );                            break;
+        case ParamGlideAuto:     glideAuto_ = value ? true : false;                break;
+        case ParamNoteBendRange: noteBendRange_ = (int)value; bendChanged_ = true; break;
+        }
+    }
+
+
+    void MidiFrequency::processVoiceEvents( const VoiceEventList& events )
+    {
+        int bentVoice = -1;
+        for (VoiceEventList::const_iterator e = events.begin(); e != events.end(); ++e)
+        {
+            switch (e->type_)
+            {
+            case VoiceEvent::Note:
+                resetNoteBend( *e, bentVoice );
+                onMidiNote( e->pitch_, e->gate_, e->voice_ );
+                break;
+            case VoiceEvent::Pitchbend:
+                onMidiPitchbend( e->bend_, e->voice_ );
+                bentVoice = e->voice_;
+                break;
+            default: break;
+            }
         }
     }
 
@@ -141,43 +134,74 @@ namespace e3 {
         if (gate != 0)
         {
             calcGlide( freq, voice );
-            freqOutport_.putEvent( freq_[voice] * bendFactor_, voice );
+            updateBendFactor( voice );
+            freqOutport_.putEvent( freq_[voice] * bendFactor_[voice], voice );
         }
     }
 
 
-    void MidiFrequency::onMidiPitchbend( int value )
+    // Only stores the value. A dense stream of pitchbend messages is applied
+    // once per control period, see processControl().
+    //
+    void MidiFrequency::onMidiPitchbend( int value, int voice )
     {
-        double cents = ((value - 0x2000) / (double)0x2000) * bendRange_ * 100;
-        bendFactor_  = pow( 2.f, cents / 1200.f );
+        double bend = (value - 0x2000) / (double)0x2000;
 
-        int maxVoices = std::min<int>( numVoices_, polyphony_->numSounding_ );
-        for (int i = 0; i < maxVoices; i++)
-        {
-            int v = polyphony_->soundingVoices_[i];
-            freqOutport_.putEvent( freq_[v] * bendFactor_, v );
+        if (voice < 0) {
+            bend_ = bend;
+        }
+        else {
+            noteBend_[voice] = bend;
         }
+        bendChanged_ = true;
+    }
+
+
+    // A note on an MPE member channel is preceded by the bend of its channel in
+    // the same batch. Any other note starts without a per note bend, even if
+    // its voice last played a bent MPE note.
+    //
+    void MidiFrequency::resetNoteBend( const VoiceEvent& e, int bentVoice )
+    {
+        if (e.gateChanged_ && e.gate_ > 0 && e.voice_ >= 0 && e.voice_ < numVoices_ && e.voice_ != bentVoice) {
+            noteBend_[e.voice_] = 0;
+        }
+    }
+
+
+    void MidiFrequency::updateBendFactor( int voice )
+    {
+        double semitones   = bend_ * bendRange_ + noteBend_[voice] * noteBendRange_;
+        bendFactor_[voice] = pow( 2., semitones / 12 );
     }
 
 
     void MidiFrequency::processControl() throw()
     {
-        if (glideFrames_ == 0)
+        if (glideFrames_ == 0 && bendChanged_ == false)
             return;
 
         int maxVoices = std::min<int>( numVoices_, polyphony_->numSounding_ );
         for (int i = 0; i < maxVoices; i++)
         {
-            int v = mono_ ? 0 : polyphony_->soundingVoices_[i];
+            int v        = mono_ ? 0 : polyphony_->soundingVoices_[i];
+            bool changed = bendChanged_;
 
+            if (bendChanged_) {
+                updateBendFactor( v );
+            }
             if (glideDelta_[v] > 0 && freq_[v] >= glideTarget_[v] || glideDelta_[v] < 0 && freq_[v] <= glideTarget_[v]) {
                 glideDelta_[v] = 0.0f;
             }
-            else {
+            else if (glideDelta_[v] != 0) {
                 freq_[v] += glideDelta_[v];
-                freqOutport_.putEvent( freq_[v] * bendFactor_, v );
+                changed   = true;
+            }
+            if (changed) {
+                freqOutport_.putEvent( freq_[v] * bendFactor_[v], v );
             }
         }
+        bendChanged_ = false;
     }
 
 
@@ -189,7 +213,7 @@ namespace e3 {
             double prevPitch    = polyphony_->getPreviousPitch( voice );
 
             if (prevPitch == -1 || glideAuto_ && polyphony_->numActive_ <= polyphony_->numUnison_) {
-                glideDeltaBuffer_.set( 0 );
+                std::fill_n( glideDelta_, numVoices_, 0.0 );
             }
             else {
                 double prevFreq     = PitchToFreq( prevPitch );
@@ -220,35 +244,51 @@ namespace e3 {
     {
         addOutport( 0, "Freq", &freqOutport_, PortTypeEvent );
         addOutport( 1, "Gate", &gateOutport_, PortTypeEvent );
+        addOutport( 2, "Pressure", &pressureOutport_, PortTypeEvent );
+        addOutport( 3, "Timbre", &timbreOutport_, PortTypeEvent );
     }
 
 
-    void MidiInput::connectSignals()
+    void MidiInput::processVoiceEvents( const VoiceEventList& events )
     {
-        if (polyphony_) {
-            polyphony_->midiNoteSignal.Connect( this, &MidiInput::onMidiNote );
-            polyphony_->midiPitchbendSignal.Connect( this, &MidiFrequency::onMidiPitchbend );
+        int bentVoice = -1;
+        for (VoiceEventList::const_iterator e = events.begin(); e != events.end(); ++e)
+        {
+            switch (e->type_)
+            {
+            case VoiceEvent::Note:
+                resetNoteBend( *e, bentVoice );
+                onMidiNote( e->pitch_, e->gate_, e->voice_ );
+                if (e->gate_ > -1) {
+                    gateOutport_.putEvent( e->gate_, e->voice_ );
+                }
+                break;
+            case VoiceEvent::Pitchbend:
+                onMidiPitchbend( e->bend_, e->voice_ );
+                bentVoice = e->voice_;
+                break;
+            case VoiceEvent::Pressure:
+                putEvent( pressureOutport_, e->value_, e->voice_ );
+                break;
+            case VoiceEvent::Timbre:
+                putEvent( timbreOutport_, e->value_, e->voice_ );
+                break;
+            default:
+                break;
+            }
         }
     }
 
 
-    void MidiInput::disconnectSignals()
+    void MidiInput::putEvent( Outport& outport, double value, int voice )
     {
-        if (polyphony_) {
-            if (polyphony_->midiNoteSignal.Empty() == false)
-                polyphony_->midiNoteSignal.Disconnect( this, &MidiInput::onMidiNote );
-            if (polyphony_->midiPitchbendSignal.Empty() == false)
-                polyphony_->midiPitchbendSignal.Disconnect( this, &MidiFrequency::onMidiPitchbend );
+        if (voice > -1) {
+            outport.putEvent( value, voice );
         }
-    }
-
-
-    void MidiInput::onMidiNote( double pitch, double gate, int voice )
-    {
-        MidiFrequency::onMidiNote( pitch, gate, voice );
-
-        if (gate > -1) {
-            gateOutport_.putEvent( gate, voice );
+        else {
+            for (int v = 0; v < numVoices_; v++) {
+                outport.putEvent( value, v );
+            }
         }
     }
 }
@@ -17,11 +17,7 @@ namespace e3 {
     public:
         MidiGate();
 
-        void connectSignals() override;
-        void disconnectSignals() override;
-        void onMidiGate( double gate, int voice);
-
-        std::string debugLabel_ = "MidiGate";
+        void processVoiceEvents( const VoiceEventList& events ) override;
 
     protected:
         Outport gateOutport_;
@@ -43,39 +39,42 @@ namespace e3 {
             ProcessingType processingType);
 
         ParameterSet& getDefaultParameters() const override;
-        void connectSignals() override;
-        void disconnectSignals() override;
 
         void initData() override;
         void setParameter(int paramId, double value, double modulation=0.f, int voice=-1) override;
+        void processVoiceEvents( const VoiceEventList& events ) override;
         void onMidiNote( double pitch, double gate, int voice );
-        void onMidiPitchbend(int value);
+        void onMidiPitchbend( int value, int voice = -1 );
         
         void processControl() throw() override;
 
-        std::string debugLabel_ = "MidiFrequency";
-
     protected:
         void calcGlide(double freq, int voice);
         void setGlideTime(double time);
 
+        void updateBendFactor( int voice );
+        void resetNoteBend( const VoiceEvent& e, int bentVoice );
+
         enum Params { 
-            ParamBendRange  = 0,
-            ParamGlideTime  = 1,
-            ParamGlideAuto  = 2,
+            ParamBendRange     = 0,
+            ParamGlideTime     = 1,
+            ParamGlideAuto     = 2,
+            ParamNoteBendRange = 3,
         };
 
-        Buffer< double > glideDeltaBuffer_, glideTargetBuffer_, freqBuffer_;
-
         double* freq_        = nullptr;
         double* glideTarget_ = nullptr;
         double* glideDelta_  = nullptr;
+        double* noteBend_    = nullptr;     // per note pitchbend (MPE), -1..1
+        double* bendFactor_  = nullptr;
 
         double glideFrames_  = 0;
         bool glideAuto_      = true;
 
-        double bendFactor_   = 1.0;
+        double bend_         = 0;           // channel pitchbend, -1..1
+        bool bendChanged_    = false;       // bend factors are updated in processControl()
         int bendRange_       = 2;
+        int noteBendRange_   = 48;
 
         Outport freqOutport_;
     };
@@ -90,14 +89,14 @@ namespace e3 {
     public:
         MidiInput();
 
-        void connectSignals() override;
-        void disconnectSignals() override;
-        void onMidiNote(double pitch, double gate, int voice);
-
-        std::string debugLabel_ = "MidiInput";
+        void processVoiceEvents( const VoiceEventList& events ) override;
 
     protected:
+        void putEvent( Outport& outport, double value, int voice );
+
         Outport gateOutport_;
+        Outport pressureOutport_;
+        Outport timbreOutport_;
     };
 
 }
@@ -2,10 +2,18 @@
 #include <e3_Exception.h>
 #include "core/Module.h"
 #include "modules/AudioOutTerminal.h"
+#include "modules/AudioInTerminal.h"
 #include "modules/MidiModules.h"
 #include "modules/AdsrEnvelope.h"
 #include "modules/SineOscillator.h"
 #include "modules/Delay.h"
+#include "modules/Pan.h"
+#include "modules/SvfFilter.h"
+#include "modules/Lfo.h"
+#include "modules/Sampler.h"
+#include "modules/Reverb.h"
+#include "modules/Noise.h"
+#include "modules/SampleAndHold.h"
 
 #include "modules/ModuleFactory.h"
 
@@ -21,9 +29,17 @@ namespace e3 {
         case ModuleTypeMidiGate:         return new MidiGate();
         case ModuleTypeMidiFrequency:    return new MidiFrequency();
         case ModuleTypeMidiInput:        return new MidiInput();
+        case ModuleTypeAudioInTerminal:  return new AudioInTerminal();
         case ModuleTypeSineOscillator:   return new SineOscillator();
         case ModuleTypeAdsrEnvelope:     return new AdsrEnvelope();
         case ModuleTypeDelay:	         return new Delay();
+        case ModuleTypePan:              return new Pan();
+        case ModuleTypeSvfFilter:        return new SvfFilter();
+        case ModuleTypeLfo:              return new Lfo();
+        case ModuleTypeSampler:          return new Sampler();
+        case ModuleTypeReverb:           return new Reverb();
+        case ModuleTypeNoise:            return new Noise();
+        case ModuleTypeSampleAndHold:    return new SampleAndHold();
 
         default: THROW( std::domain_error, "module type %d does not exist", type );
         }
@@ -36,9 +52,17 @@ namespace e3 {
         { ModuleTypeMidiGate,         "Midi Gate" },
         { ModuleTypeMidiFrequency,    "Midi Frequency" },
         { ModuleTypeMidiInput,        "Midi Input" },
+        { ModuleTypeAudioInTerminal,  "Audio In" },
         { ModuleTypeSineOscillator,   "Sine" },
         { ModuleTypeAdsrEnvelope,     "ADSR" },
-        { ModuleTypeDelay,            "Delay" }
+        { ModuleTypeDelay,            "Delay" },
+        { ModuleTypePan,              "Pan" },
+        { ModuleTypeSvfFilter,        "Filter" },
+        { ModuleTypeLfo,              "LFO" },
+        { ModuleTypeSampler,          "Sampler" },
+        { ModuleTypeReverb,           "Reverb" },
+        { ModuleTypeNoise,            "Noise" },
+        { ModuleTypeSampleAndHold,    "S&H" }
     };
 
 
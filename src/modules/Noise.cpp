@@ -0,0 +1,106 @@
+
+#include <e3_Exception.h>
+#include "core/Polyphony.h"
+#include "modules/Noise.h"
+
+
+namespace e3 {
+
+    Noise::Noise() : Module(
+        ModuleTypeNoise,
+        "Noise",
+        Polyphonic,
+        (ProcessingType)(ProcessEvent | ProcessAudio) )
+    {
+        addInport( 0, "Amp", &ampInport_, &eventSetter< Noise, &Noise::setAmplitude > );
+        addOutport( 0, "White", &whiteOutport_, PortTypeAudio );
+        addOutport( 1, "Pink", &pinkOutport_, PortTypeAudio );
+    }
+
+
+    ParameterSet& Noise::getDefaultParameters() const
+    {
+        static ParameterSet set;
+        set.clear();
+
+        const Parameter& paramSeed = set.addModuleParameter( ParamSeed, id_, "Seed", ControlNumEdit, 0 );
+        paramSeed.valueShaper_ = { 0, 999, 999 };
+        paramSeed.numberFormat_ = NumberInt;
+
+        return set;
+    }
+
+
+    void Noise::initData()
+    {
+        Module::initData();
+
+        state_     = allocate< uint32_t >( numVoices_ * Random::NumLanes, 0 );
+        values_    = allocate< float >( numVoices_ * Random::NumLanes, 0 );
+        index_     = allocate< uint8_t >( numVoices_, 0 );
+        amplitude_ = allocate< double >( numVoices_, 1 );
+        pink_      = allocate< double >( numVoices_ * 3, 0 );
+
+        seedVoices();
+    }
+
+
+    void Noise::updatePorts()
+    {
+        bool white = whiteOutport_.getNumAudioConnections() > 0;
+        bool pink  = pinkOutport_.getNumAudioConnections() > 0;
+
+        processFunction_ = (white || pink) ? ProcessFunctionSelector< Kernels >::select( mono_, white, pink ) : nullptr;
+    }
+
+
+    void Noise::resume()
+    {
+        seedVoices();
+    }
+
+
+    void Noise::seedVoices()
+    {
+        for (int v = 0; v < numVoices_; v++) {
+            seedVoice( v, 0 );
+        }
+    }
+
+
+    void Noise::seedVoice( int voice, int note )
+    {
+        Random::seed( state_ + voice * Random::NumLanes, Random::getSeed( id_, voice, seed_, note ) );
+        index_[voice] = Random::NumLanes;       // generate on the next frame
+        pink_[voice * 3] = pink_[voice * 3 + 1] = pink_[voice * 3 + 2] = 0;
+    }
+
+
+    void Noise::processVoiceEvents( const VoiceEventList& events )
+    {
+        for (VoiceEventList::const_iterator e = events.begin(); e != events.end(); ++e)
+        {
+            if (e->type_ == VoiceEvent::Note && e->gateChanged_ && e->gate_ > 0) {
+                seedVoice( mono_ ? 0 : e->voice_, (int)e->pitch_ );
+            }
+        }
+    }
+
+
+    void Noise::setParameter( int paramId, double value, double modulation, int voice )
+    {
+        switch (paramId)
+        {
+        case ParamAmplitude: if (voice >= 0) setAmplitude( value, modulation, std::min<int>( numVoices_ - 1, voice ) ); break;
+        case ParamSeed:      seed_ = (int)value; seedVoices(); break;
+        }
+    }
+
+
+    void Noise::setAmplitude( double value, double modulation, int voice )
+    {
+        ASSERT( voice >= 0 && voice < numVoices_ );
+        amplitude_[voice] = value * modulation;
+    }
+
+} // namespace e3
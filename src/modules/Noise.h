@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include "core/Module.h"
+#include "core/Polyphony.h"
+#include "core/Random.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class Noise
+    // White and pink noise per voice. The white noise comes from Random, four
+    // values per voice at a time. The pink noise is the white noise through
+    // the three pole filter of Paul Kellet, -3 dB per octave within 0.5 dB.
+    // Only the connected outports are computed. A note seeds its voice by
+    // the module id, the voice, the key and the Seed parameter, so a note
+    // renders the same noise in the same voice, whatever played before.
+    // resume() and the Seed parameter seed all voices as before the first note.
+    //--------------------------------------------------------------------------
+
+    class Noise : public Module
+    {
+    public:
+        Noise();
+
+        ParameterSet& getDefaultParameters() const override;
+        void initData() override;
+        void updatePorts() override;
+        void resume() override;
+        void processVoiceEvents( const VoiceEventList& events ) override;
+
+        void setParameter( int paramId, double value, double modulation = 0.f, int voice = -1 ) override;
+        void setAmplitude( double value, double modulation, int voice );
+
+        template< bool Mono, bool White, bool Pink > void processAudio() throw();
+
+        struct Kernels
+        {
+            template< bool Mono, bool White, bool Pink > static ProcessFunctionPointer get()
+            {
+                return static_cast<ProcessFunctionPointer>(&Noise::processAudio< Mono, White, Pink >);
+            }
+        };
+
+        enum ParamId {
+            ParamAmplitude = 0,
+            ParamSeed      = 1
+        };
+
+    protected:
+        void seedVoices();
+        void seedVoice( int voice, int note );
+
+        int seed_ = 0;
+
+        uint32_t* state_   = nullptr;       // Random::NumLanes per voice
+        float* values_     = nullptr;       // Random::NumLanes per voice
+        uint8_t* index_    = nullptr;       // next of the values
+        double* amplitude_ = nullptr;
+        double* pink_      = nullptr;       // 3 filter states per voice
+
+        Inport ampInport_;
+        Outport whiteOutport_;
+        Outport pinkOutport_;
+    };
+
+
+    template< bool Mono, bool White, bool Pink >
+    inline void Noise::processAudio() throw()
+    {
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = Mono ? 0 : polyphony_->soundingVoices_[i];
+
+            if (index_[v] >= Random::NumLanes)
+            {
+                Random::generate( state_ + v * Random::NumLanes, values_ + v * Random::NumLanes );
+                index_[v] = 0;
+            }
+            double white = values_[v * Random::NumLanes + index_[v]++] * amplitude_[v];
+
+            if (White) {
+                whiteOutport_.putAudio( white, v );
+            }
+            if (Pink)
+            {
+                double* b = pink_ + v * 3;
+                b[0] = 0.99765 * b[0] + white * 0.0990460;
+                b[1] = 0.96300 * b[1] + white * 0.2965164;
+                b[2] = 0.57000 * b[2] + white * 1.0526913;
+                pinkOutport_.putAudio( (b[0] + b[1] + b[2] + white * 0.1848) * 0.25, v );
+            }
+        }
+    }
+
+} // namespace e3
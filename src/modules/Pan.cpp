@@ -0,0 +1,104 @@
+
+#include <cmath>
+#include "core/Polyphony.h"
+#include "modules/Pan.h"
+
+
+namespace e3 {
+
+    Pan::Pan() : Module(
+        ModuleTypePan,
+        "Pan",
+        Polyphonic,
+        (ProcessingType)(ProcessEvent | ProcessAudio) )
+    {
+        addInport( 0, "In", &audioInport_ );
+        addInport( 1, "Pan", &panInport_, &eventSetter< Pan, &Pan::setVoicePan > );
+        addOutport( 0, "Left", &leftOutport_, PortTypeAudio );
+        addOutport( 1, "Right", &rightOutport_, PortTypeAudio );
+    }
+
+
+    ParameterSet& Pan::getDefaultParameters() const
+    {
+        static ParameterSet set;
+        set.clear();
+
+        const Parameter& paramPosition = set.addModuleParameter( ParamPosition, id_, "Position", ControlBiSlider, 0 );
+        paramPosition.valueShaper_ = { -1, 1, 200 };
+
+        set.addModuleParameter( ParamWidth, id_, "Width", ControlSlider, 1 );
+
+        return set;
+    }
+
+
+    void Pan::initData()
+    {
+        Module::initData();
+
+        audioInportPointer_ = audioInport_.getAudioBuffer();
+        voicePan_  = allocate< double >( numVoices_, 0 );
+        gainLeft_  = allocate< double >( numVoices_, 0 );
+        gainRight_ = allocate< double >( numVoices_, 0 );
+
+        for (int v = 0; v < numVoices_; v++) {
+            updateGains( v );
+        }
+    }
+
+
+    void Pan::updatePorts()
+    {
+        bool stereo = rightOutport_.getNumAudioConnections() > 0;
+        processFunction_ = ProcessFunctionSelector< Kernels >::select( mono_, stereo );
+    }
+
+
+    // A voice takes its place in the unison group when its note starts.
+    void Pan::processVoiceEvents( const VoiceEventList& events )
+    {
+        for (VoiceEventList::const_iterator e = events.begin(); e != events.end(); ++e)
+        {
+            if (e->type_ == VoiceEvent::Note && e->gateChanged_ && e->gate_ > 0 && e->voice_ < numVoices_) {
+                updateGains( e->voice_ );
+            }
+        }
+    }
+
+
+    void Pan::setParameter( int paramId, double value, double modulation, int voice )
+    {
+        switch (paramId)
+        {
+        case ParamPan:      if (voice >= 0) setVoicePan( value, modulation, voice ); return;
+        case ParamPosition: position_ = value; break;
+        case ParamWidth:    width_    = value; break;
+        default: return;
+        }
+        for (int v = 0; v < numVoices_; v++) {
+            updateGains( v );
+        }
+    }
+
+
+    void Pan::setVoicePan( double value, double modulation, int voice )
+    {
+        voice = std::min<int>( numVoices_ - 1, voice );
+        voicePan_[voice] = value * modulation;
+        updateGains( voice );
+    }
+
+
+    void Pan::updateGains( int voice )
+    {
+        double unison = mono_ ? 0 : polyphony_->voices_[voice].pan_;
+        double pan    = position_ + width_ * unison + voicePan_[voice];
+        pan           = std::max<double>( -1, std::min<double>( 1, pan ) );
+
+        double angle      = (pan + 1) * PI / 4;        // constant power: 0 left, PI/2 right
+        gainLeft_[voice]  = cos( angle );
+        gainRight_[voice] = sin( angle );
+    }
+
+} // namespace e3
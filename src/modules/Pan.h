@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include "core/Module.h"
+#include "core/Polyphony.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class Pan
+    // Places each voice in the stereo field, with constant power. The place
+    // of a voice is the Position parameter, plus its place in the unison
+    // group scaled by Width, plus the value at the Pan inport.
+    // The gains are computed when a note starts or a value changes, the
+    // kernel only multiplies.
+    //--------------------------------------------------------------------------
+
+    class Pan : public Module
+    {
+    public:
+        Pan();
+
+        ParameterSet& getDefaultParameters() const override;
+        void initData() override;
+        void updatePorts() override;
+        void processVoiceEvents( const VoiceEventList& events ) override;
+
+        void setParameter( int paramId, double value, double modulation = 0.f, int voice = -1 ) override;
+        void setVoicePan( double value, double modulation, int voice );
+
+        // Stereo: the Right outport has audio connections.
+        template< bool Mono, bool Stereo > void processAudio() throw();
+
+        struct Kernels
+        {
+            template< bool Mono, bool Stereo > static ProcessFunctionPointer get()
+            {
+                return static_cast<ProcessFunctionPointer>(&Pan::processAudio< Mono, Stereo >);
+            }
+        };
+
+        enum ParamId {
+            ParamPan      = 1,      // the Pan inport
+            ParamPosition = 2,
+            ParamWidth    = 3
+        };
+
+        const double* getGains( int channel ) const     { return channel == 0 ? gainLeft_ : gainRight_; }
+
+    protected:
+        void updateGains( int voice );
+
+        double position_ = 0;
+        double width_    = 1;
+
+        double* voicePan_  = nullptr;
+        double* gainLeft_  = nullptr;
+        double* gainRight_ = nullptr;
+
+        Inport audioInport_;
+        Inport panInport_;
+        Outport leftOutport_;
+        Outport rightOutport_;
+        double* audioInportPointer_ = nullptr;
+    };
+
+
+    template< bool Mono, bool Stereo >
+    inline void Pan::processAudio() throw()
+    {
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = Mono ? 0 : polyphony_->soundingVoices_[i];
+            double input   = audioInportPointer_[v];
+            audioInportPointer_[v] = 0;
+
+            leftOutport_.putAudio( input * gainLeft_[v], v );
+            if (Stereo) {
+                rightOutport_.putAudio( input * gainRight_[v], v );
+            }
+        }
+    }
+
+} // namespace e3
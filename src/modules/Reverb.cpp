@@ -0,0 +1,130 @@
+
+#include <cmath>
+#include <algorithm>
+#include <e3_Exception.h>
+#include "modules/Reverb.h"
+
+
+namespace e3 {
+
+    namespace {
+        // msec at size 1, no two share a common factor
+        const double lineTimes[Reverb::NumLines] = { 31.3, 37.9, 41.1, 45.7, 51.7, 57.1, 63.7, 69.1 };
+    }
+
+
+    Reverb::Reverb() : Module(
+        ModuleTypeReverb,
+        "Reverb",
+        Monophonic,
+        ProcessAudio )
+    {
+        addInport( 0, "Left", &leftInport_ );
+        addInport( 1, "Right", &rightInport_ );
+        addOutport( 0, "Left", &leftOutport_, PortTypeAudio );
+        addOutport( 1, "Right", &rightOutport_, PortTypeAudio );
+    }
+
+
+    ParameterSet& Reverb::getDefaultParameters() const
+    {
+        static ParameterSet set;
+        set.clear();
+
+        const Parameter& paramSize = set.addModuleParameter( ParamSize, id_, "Size", ControlSlider, 0.7 );
+        paramSize.valueShaper_ = { 0.1, 1, 90 };
+
+        const Parameter& paramDecay = set.addModuleParameter( ParamDecay, id_, "Decay", ControlSlider, 2 );
+        paramDecay.valueShaper_ = { 0.1, 20, 199 };
+        paramDecay.unit_ = "sec";
+        paramDecay.numberFormat_ = NumberFloat;
+
+        const Parameter& paramDamping = set.addModuleParameter( ParamDamping, id_, "Damping", ControlSlider, 0.3 );
+        paramDamping.valueShaper_ = { 0, 0.95, 95 };
+
+        const Parameter& paramMix = set.addModuleParameter( ParamMix, id_, "Mix", ControlSlider, 0.3 );
+        paramMix.valueShaper_ = { 0, 1, 100 };
+
+        return set;
+    }
+
+
+    // The lines are sized for the largest room at the new sample rate, before
+    // initData() takes them from the arena. Size only moves the taps.
+    void Reverb::init( double sampleRate, int numVoices, Polyphony* polyphony, Arena* arena )
+    {
+        uint32_t maxLength = (uint32_t)(lineTimes[NumLines - 1] * 0.001 * sampleRate) + 1;
+        lineSize_ = 1;
+        while (lineSize_ < maxLength) {
+            lineSize_ <<= 1;
+        }
+        mask_ = lineSize_ - 1;
+
+        Module::init( sampleRate, numVoices, polyphony, arena );
+    }
+
+
+    void Reverb::initData()
+    {
+        Module::initData();
+
+        leftInportPointer_  = leftInport_.getAudioBuffer();
+        rightInportPointer_ = rightInport_.getAudioBuffer();
+
+        lines_  = allocate< float >( NumLines * lineSize_, 0 );
+        cursor_ = 0;
+        for (int i = 0; i < NumLines; i++) {
+            lowpass_[i] = 0;
+        }
+    }
+
+
+    void Reverb::updatePorts()
+    {
+        processFunction_ = ProcessFunctionSelector< Kernels >::select( rightInport_.getNumAudioConnections() > 0 );
+    }
+
+
+    void Reverb::setSampleRate( double sampleRate )
+    {
+        Module::setSampleRate( sampleRate );
+        updateLines();
+    }
+
+
+    void Reverb::resume()
+    {
+        std::fill_n( lines_, NumLines * lineSize_, 0.f );
+        for (int i = 0; i < NumLines; i++) {
+            lowpass_[i] = 0;
+        }
+    }
+
+
+    void Reverb::setParameter( int paramId, double value, double, int )
+    {
+        switch (paramId)
+        {
+        case ParamSize:    size_    = std::max<double>( 0.1, std::min<double>( 1, value ) ); updateLines(); break;
+        case ParamDecay:   decay_   = std::max<double>( 0.01, value ); updateLines(); break;
+        case ParamDamping: damping_ = std::max<double>( 0, std::min<double>( 0.95, value ) ); break;
+        case ParamMix:
+            value = std::max<double>( 0, std::min<double>( 1, value ) );
+            dry_  = 1 - value;
+            wet_  = value * 0.5;        // four taps per side
+            break;
+        }
+    }
+
+
+    // A line of n samples passes its signal decay * sampleRate / n times until -60 dB.
+    void Reverb::updateLines()
+    {
+        for (int i = 0; i < NumLines; i++)
+        {
+            length_[i] = std::max<uint32_t>( 1, std::min<uint32_t>( mask_, (uint32_t)(lineTimes[i] * 0.001 * size_ * sampleRate_) ) );
+            gain_[i]   = pow( 10, -3.0 * length_[i] / (decay_ * sampleRate_) );
+        }
+    }
+
+} // namespace e3
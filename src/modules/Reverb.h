@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include "core/Module.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class Reverb
+    // Feedback delay network of NumLines delay lines for the effect bus, the
+    // monophonic part of the graph after the voices are summed. It runs every
+    // frame, whether voices sound or not, so the tail fades out on its own.
+    // The lines are mixed by a Householder matrix, which costs one sum per
+    // frame instead of a matrix product, and lose Decay seconds to -60 dB.
+    // Each line is damped by a one pole lowpass. All lines have the same
+    // power of two size, so one cursor and one mask address them. They store
+    // floats, half the memory of doubles, with no audible difference, and are
+    // allocated from the arena of the instrument.
+    //--------------------------------------------------------------------------
+
+    class Reverb : public Module
+    {
+    public:
+        Reverb();
+
+        ParameterSet& getDefaultParameters() const override;
+        void init( double sampleRate, int numVoices, Polyphony* polyphony, Arena* arena ) override;
+        void initData() override;
+        void updatePorts() override;
+        void resume() override;
+        void setParameter( int paramId, double value, double modulation = 0.f, int voice = -1 ) override;
+
+        // Stereo: the Right inport has audio connections, else the left input feeds both sides.
+        template< bool Stereo > void processAudio() throw();
+
+        struct Kernels
+        {
+            template< bool Stereo > static ProcessFunctionPointer get()
+            {
+                return static_cast<ProcessFunctionPointer>(&Reverb::processAudio< Stereo >);
+            }
+        };
+
+        enum ParamId {
+            ParamLeft    = 0,
+            ParamRight   = 1,
+            ParamSize    = 2,
+            ParamDecay   = 3,
+            ParamDamping = 4,
+            ParamMix     = 5
+        };
+
+        enum {
+            NumLines = 8
+        };
+
+        uint32_t getLineSize() const                { return lineSize_; }
+
+    protected:
+        void setSampleRate( double sampleRate ) override;
+        void updateLines();
+
+        double size_    = 0.7;
+        double decay_   = 2;        // sec
+        double damping_ = 0.3;
+        double dry_     = 0.7;
+        double wet_     = 0.15;
+
+        uint32_t lineSize_ = 0;
+        uint32_t mask_     = 0;
+        uint32_t cursor_   = 0;
+        uint32_t length_[NumLines];
+        double gain_[NumLines];
+        double lowpass_[NumLines];
+
+        float* lines_ = nullptr;            // NumLines * lineSize_
+
+        Inport leftInport_;
+        Inport rightInport_;
+        Outport leftOutport_;
+        Outport rightOutport_;
+        double* leftInportPointer_  = nullptr;
+        double* rightInportPointer_ = nullptr;
+    };
+
+
+    template< bool Stereo >
+    inline void Reverb::processAudio() throw()
+    {
+        double left = *leftInportPointer_;
+        *leftInportPointer_ = 0;
+
+        double right = left;
+        if (Stereo) {
+            right = *rightInportPointer_;
+            *rightInportPointer_ = 0;
+        }
+        double input = (left + right) * 0.5;
+
+        double tap[NumLines];
+        double feedback[NumLines];
+        double sum = 0;
+        for (int i = 0; i < NumLines; i++)
+        {
+            tap[i]      = lines_[i * lineSize_ + ((cursor_ - length_[i]) & mask_)];
+            lowpass_[i] = tap[i] + damping_ * (lowpass_[i] - tap[i]);
+            feedback[i] = lowpass_[i] * gain_[i];
+            sum        += feedback[i];
+        }
+        sum *= 2.0 / NumLines;
+
+        // 1e-20 keeps the decaying floats out of the denormal range
+        double wetLeft = 0, wetRight = 0;
+        for (int i = 0; i < NumLines; i += 2)
+        {
+            lines_[i * lineSize_ + cursor_]       = (float)(feedback[i] - sum + input + 1e-20);
+            lines_[(i + 1) * lineSize_ + cursor_] = (float)(feedback[i + 1] - sum - input + 1e-20);
+            wetLeft  += tap[i];
+            wetRight += tap[i + 1];
+        }
+        cursor_ = (cursor_ + 1) & mask_;
+
+        leftOutport_.putAudio( dry_ * left + wet_ * wetLeft );
+        rightOutport_.putAudio( dry_ * right + wet_ * wetRight );
+    }
+
+} // namespace e3
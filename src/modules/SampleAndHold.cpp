@@ -0,0 +1,110 @@
+
+#include <e3_Exception.h>
+#include "core/Polyphony.h"
+#include "modules/SampleAndHold.h"
+
+
+namespace e3 {
+
+    SampleAndHold::SampleAndHold() : Module(
+        ModuleTypeSampleAndHold,
+        "S&H",
+        Polyphonic,
+        (ProcessingType)(ProcessEvent | ProcessAudio) )
+    {
+        addInport( 0, "In", &audioInport_ );
+        addOutport( 0, "Out", &audioOutport_, PortTypeAudio );
+    }
+
+
+    ParameterSet& SampleAndHold::getDefaultParameters() const
+    {
+        static ParameterSet set;
+        set.clear();
+
+        const Parameter& paramRate = set.addModuleParameter( ParamRate, id_, "Rate", ControlSlider, 10 );
+        paramRate.valueShaper_ = { 0.1, 10000, 1000, 12 };
+        paramRate.unit_ = "Hz";
+        paramRate.numberFormat_ = NumberFloat;
+
+        const Parameter& paramSeed = set.addModuleParameter( ParamSeed, id_, "Seed", ControlNumEdit, 0 );
+        paramSeed.valueShaper_ = { 0, 999, 999 };
+        paramSeed.numberFormat_ = NumberInt;
+
+        return set;
+    }
+
+
+    void SampleAndHold::initData()
+    {
+        Module::initData();
+
+        state_  = allocate< uint32_t >( numVoices_ * Random::NumLanes, 0 );
+        values_ = allocate< float >( numVoices_ * Random::NumLanes, 0 );
+        index_  = allocate< uint8_t >( numVoices_, 0 );
+        phase_  = allocate< double >( numVoices_, 2 );
+        hold_   = allocate< double >( numVoices_, 0 );
+
+        audioInportPointer_ = audioInport_.getAudioBuffer();
+        seedVoices();
+    }
+
+
+    void SampleAndHold::updatePorts()
+    {
+        processFunction_ = ProcessFunctionSelector< Kernels >::select( mono_, audioInport_.getNumAudioConnections() > 0 );
+    }
+
+
+    void SampleAndHold::setSampleRate( double sampleRate )
+    {
+        Module::setSampleRate( sampleRate );
+        increment_ = rate_ / sampleRate_;
+    }
+
+
+    void SampleAndHold::resume()
+    {
+        seedVoices();
+    }
+
+
+    void SampleAndHold::seedVoices()
+    {
+        for (int v = 0; v < numVoices_; v++) {
+            seedVoice( v, 0 );
+        }
+    }
+
+
+    void SampleAndHold::seedVoice( int voice, int note )
+    {
+        Random::seed( state_ + voice * Random::NumLanes, Random::getSeed( id_, voice, seed_, note ) );
+        index_[voice] = Random::NumLanes;
+    }
+
+
+    void SampleAndHold::processVoiceEvents( const VoiceEventList& events )
+    {
+        for (VoiceEventList::const_iterator e = events.begin(); e != events.end(); ++e)
+        {
+            if (e->type_ == VoiceEvent::Note && e->gateChanged_ && e->gate_ > 0)
+            {
+                int v     = mono_ ? 0 : e->voice_;
+                phase_[v] = 2;
+                seedVoice( v, (int)e->pitch_ );
+            }
+        }
+    }
+
+
+    void SampleAndHold::setParameter( int paramId, double value, double, int )
+    {
+        switch (paramId)
+        {
+        case ParamRate: rate_ = std::max<double>( 0, value ); increment_ = rate_ / sampleRate_; break;
+        case ParamSeed: seed_ = (int)value; seedVoices(); break;
+        }
+    }
+
+} // namespace e3
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include "core/Module.h"
+#include "core/Polyphony.h"
+#include "core/Random.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class SampleAndHold
+    // Takes a sample of its input Rate times per second and holds it. With
+    // nothing connected to the In inport it samples its own noise, seeded
+    // like the Noise module, which makes random steps for modulation. A note
+    // takes a new sample at once, the first of the noise seeded for the note.
+    //--------------------------------------------------------------------------
+
+    class SampleAndHold : public Module
+    {
+    public:
+        SampleAndHold();
+
+        ParameterSet& getDefaultParameters() const override;
+        void initData() override;
+        void updatePorts() override;
+        void resume() override;
+        void processVoiceEvents( const VoiceEventList& events ) override;
+
+        void setParameter( int paramId, double value, double modulation = 0.f, int voice = -1 ) override;
+
+        // Input: the In inport has audio connections, else the noise is sampled.
+        template< bool Mono, bool Input > void processAudio() throw();
+
+        struct Kernels
+        {
+            template< bool Mono, bool Input > static ProcessFunctionPointer get()
+            {
+                return static_cast<ProcessFunctionPointer>(&SampleAndHold::processAudio< Mono, Input >);
+            }
+        };
+
+        enum ParamId {
+            ParamAudioIn = 0,
+            ParamRate    = 1,
+            ParamSeed    = 2
+        };
+
+    protected:
+        void setSampleRate( double sampleRate ) override;
+        void seedVoices();
+        void seedVoice( int voice, int note );
+
+        double rate_      = 10;             // Hz
+        double increment_ = 0;
+        int seed_         = 0;
+
+        uint32_t* state_ = nullptr;         // Random::NumLanes per voice
+        float* values_   = nullptr;
+        uint8_t* index_  = nullptr;
+        double* phase_   = nullptr;
+        double* hold_    = nullptr;
+
+        Inport audioInport_;
+        Outport audioOutport_;
+        double* audioInportPointer_ = nullptr;
+    };
+
+
+    template< bool Mono, bool Input >
+    inline void SampleAndHold::processAudio() throw()
+    {
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = Mono ? 0 : polyphony_->soundingVoices_[i];
+            double input   = 0;
+            if (Input) {
+                input = audioInportPointer_[v];
+                audioInportPointer_[v] = 0;
+            }
+
+            if (phase_[v] >= 1)
+            {
+                phase_[v] -= (phase_[v] >= 2) ? phase_[v] : 1;      // a note sets 2
+                if (Input) {
+                    hold_[v] = input;
+                }
+                else {
+                    if (index_[v] >= Random::NumLanes)
+                    {
+                        Random::generate( state_ + v * Random::NumLanes, values_ + v * Random::NumLanes );
+                        index_[v] = 0;
+                    }
+                    hold_[v] = values_[v * Random::NumLanes + index_[v]++];
+                }
+            }
+            phase_[v] += increment_;
+            audioOutport_.putAudio( hold_[v], v );
+        }
+    }
+
+} // namespace e3
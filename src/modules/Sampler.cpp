@@ -0,0 +1,218 @@
+
+#include <e3_Math.h>
+#include <e3_Exception.h>
+#include "core/Polyphony.h"
+#include "modules/Sampler.h"
+
+
+namespace e3 {
+
+    Sampler::Sampler() : Module(
+        ModuleTypeSampler,
+        "Sampler",
+        Polyphonic,
+        (ProcessingType)(ProcessEvent | ProcessControl | ProcessAudio) )
+    {
+        addInport( 0, "Freq", &freqInport_, &eventSetter< Sampler, &Sampler::setFrequency > );
+        addInport( 1, "Amp", &ampInport_, &eventSetter< Sampler, &Sampler::setAmplitude > );
+        addOutport( 0, "Left", &leftOutport_, PortTypeAudio );
+        addOutport( 1, "Right", &rightOutport_, PortTypeAudio );
+    }
+
+
+    // Module::~Module() calls the reset() of the base only.
+    Sampler::~Sampler()
+    {
+        removeStreams();
+    }
+
+
+    ParameterSet& Sampler::getDefaultParameters() const
+    {
+        static ParameterSet set;
+        set.clear();
+
+        const Parameter& paramRootKey = set.addModuleParameter( ParamRootKey, id_, "Root Key", ControlNumEdit, 60 );
+        paramRootKey.valueShaper_ = { 0, 127, 127 };
+        paramRootKey.numberFormat_ = NumberInt;
+
+        return set;
+    }
+
+
+    // The streams go first, the DiskStreamer must not fill them while they change.
+    // The ring of a stream holds the frames behind the head up to MaxCapacity,
+    // a mono file uses one channel for left and right.
+    void Sampler::initData()
+    {
+        Module::initData();
+        removeStreams();
+        loadSample();
+
+        position_  = allocate< double >( numVoices_, 0 );
+        increment_ = allocate< double >( numVoices_, 1 );
+        freq_      = allocate< double >( numVoices_, rootFreq_ );
+        amplitude_ = allocate< double >( numVoices_, 1 );
+        streamEnd_ = allocate< int64_t >( numVoices_, -1 );
+        playing_   = allocate< uint8_t >( numVoices_, 0 );
+        underrun_  = allocate< uint8_t >( numVoices_, 0 );
+
+        if (sample_ != nullptr && numFrames_ > numHeadFrames_)
+        {
+            int capacity = SampleStream::getCapacity( *sample_ );
+            bool stereo  = sample_->getNumChannels() > 1;
+
+            numStreams_ = numVoices_;
+            streams_.reset( new SampleStream[numStreams_] );
+            for (int i = 0; i < numStreams_; i++)
+            {
+                float* left  = allocate< float >( capacity, 0 );
+                float* right = stereo ? allocate< float >( capacity, 0 ) : left;
+                streams_[i].setBuffer( left, right, capacity );
+                streams_[i].setFile( sample_ );
+                DiskStreamer::add( &streams_[i] );
+            }
+        }
+    }
+
+
+    void Sampler::reset()
+    {
+        removeStreams();
+        Module::reset();
+    }
+
+
+    // A file that can not be read leaves the sampler silent.
+    void Sampler::loadSample()
+    {
+        if (sample_ == nullptr || sample_->getPath() != resource_)
+        {
+            sample_.reset();
+            if (resource_.empty() == false) {
+                sample_ = SampleFile::load( resource_ );
+            }
+        }
+
+        numFrames_     = (sample_ != nullptr) ? sample_->getNumFrames() : 0;
+        numHeadFrames_ = (sample_ != nullptr) ? sample_->getNumHeadFrames() : 0;
+        headLeft_      = (sample_ != nullptr) ? sample_->getHead( 0 ) : nullptr;
+        headRight_     = (sample_ != nullptr) ? sample_->getHead( 1 ) : nullptr;
+    }
+
+
+    void Sampler::removeStreams()
+    {
+        for (int i = 0; i < numStreams_; i++) {
+            DiskStreamer::remove( &streams_[i] );
+        }
+        streams_.reset();
+        numStreams_ = 0;
+    }
+
+
+    void Sampler::updatePorts()
+    {
+        processFunction_ = (sample_ != nullptr) ? ProcessFunctionSelector< Kernels >::select( mono_ ) : nullptr;
+    }
+
+
+    void Sampler::setSampleRate( double sampleRate )
+    {
+        Module::setSampleRate( sampleRate );
+        rateRatio_ = (sample_ != nullptr) ? sample_->getSampleRate() / sampleRate_ : 1;
+
+        for (int i = 0; i < numVoices_; i++) {
+            setIncrement( i );
+        }
+    }
+
+
+    // The consumer has passed the frames before position - 1, the ring only holds frames behind the head.
+    void Sampler::processControl() throw()
+    {
+        if (numStreams_ == 0) return;
+
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = mono_ ? 0 : polyphony_->soundingVoices_[i];
+            if (playing_[v]) {
+                streams_[v].setReadPosition( std::max<int64_t>( numHeadFrames_, (int64_t)position_[v] - 1 ) );
+            }
+        }
+    }
+
+
+    // A note plays the sample from the start, the stream begins behind the head.
+    void Sampler::processVoiceEvents( const VoiceEventList& events )
+    {
+        if (sample_ == nullptr) return;
+
+        for (VoiceEventList::const_iterator e = events.begin(); e != events.end(); ++e)
+        {
+            if (e->type_ == VoiceEvent::Note && e->gateChanged_ && e->gate_ > 0 && e->voice_ < numVoices_)
+            {
+                int v         = e->voice_;
+                position_[v]  = 0;
+                playing_[v]   = 1;
+                underrun_[v]  = 0;
+                streamEnd_[v] = -1;
+                if (numStreams_ > 0) {
+                    streams_[v].start( numHeadFrames_ );
+                }
+            }
+        }
+    }
+
+
+    void Sampler::setParameter( int paramId, double value, double modulation, int voice )
+    {
+        voice = std::min<int>( numVoices_ - 1, voice );
+
+        switch (paramId)
+        {
+        case ParamFrequency: if (voice >= 0) setFrequency( value, modulation, voice ); break;
+        case ParamAmplitude: if (voice >= 0) setAmplitude( value, modulation, voice ); break;
+        case ParamRootKey:
+            rootFreq_ = PitchToFreq( std::max<double>( 0, std::min<double>( 127, value ) ) );
+            for (int i = 0; i < numVoices_; i++) {
+                setIncrement( i );
+            }
+            break;
+        }
+    }
+
+
+    // Same scaling by the link as SineOscillator::setFrequency().
+    void Sampler::setFrequency( double value, double modulation, int voice )
+    {
+        ASSERT( voice >= 0 && voice < numVoices_ );
+
+        double freq;
+        if (modulation < 0) {
+            double pitch = FreqToPitch( value );
+            pitch        = (pitch - 60) * modulation + 60;
+            freq         = (double)PitchToFreq( pitch );
+        }
+        else {
+            freq = (value - 261.62557f) * modulation + 261.62557f;
+        }
+        freq_[voice] = freq;
+        setIncrement( voice );
+    }
+
+
+    void Sampler::setAmplitude( double value, double modulation, int voice )
+    {
+        ASSERT( voice >= 0 && voice < numVoices_ );
+        amplitude_[voice] = value * modulation;
+    }
+
+
+    void Sampler::setIncrement( int voice )
+    {
+        increment_[voice] = std::max<double>( 0, freq_[voice] / rootFreq_ * rateRatio_ );
+    }
+
+} // namespace e3
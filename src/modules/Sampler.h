@@ -0,0 +1,178 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <emmintrin.h>
+#include "core/Module.h"
+#include "core/Polyphony.h"
+#include "core/DiskStreamer.h"
+#include "core/AudioTrace.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class Sampler
+    // Plays the file given as resource of the module, transposed by the
+    // frequency at the Freq inport relative to the root key. The head of the
+    // file is in memory, the rest comes from a SampleStream per voice, which
+    // the DiskStreamer thread fills in the background. A file that fits into
+    // the head has no streams. A frame that has not
+    // arrived yet is played as silence, the kernel never waits for the disk.
+    // Resampling is done by 4-point Hermite interpolation, left and right are
+    // computed together in one pair of SSE2 doubles.
+    //--------------------------------------------------------------------------
+
+    class Sampler : public Module
+    {
+    public:
+        Sampler();
+        ~Sampler();
+
+        ParameterSet& getDefaultParameters() const override;
+        void initData() override;
+        void updatePorts() override;
+        void processControl() throw() override;
+        void processVoiceEvents( const VoiceEventList& events ) override;
+
+        void setParameter( int paramId, double value, double modulation = 0.f, int voice = -1 ) override;
+        void setFrequency( double value, double modulation, int voice );
+        void setAmplitude( double value, double modulation, int voice );
+
+        template< bool Mono > void processAudio() throw();
+
+        struct Kernels
+        {
+            template< bool Mono > static ProcessFunctionPointer get()
+            {
+                return static_cast<ProcessFunctionPointer>(&Sampler::processAudio< Mono >);
+            }
+        };
+
+        enum ParamId {
+            ParamFrequency = 0,
+            ParamAmplitude = 1,
+            ParamRootKey   = 2
+        };
+
+        const SampleFile* getSample() const         { return sample_.get(); }
+        bool isPlaying( int voice ) const           { return playing_[voice] != 0; }
+        const SampleStream* getStream( int voice ) const  { return voice < numStreams_ ? &streams_[voice] : nullptr; }
+
+    protected:
+        void reset() override;
+        void setSampleRate( double sampleRate ) override;
+        void loadSample();
+        void removeStreams();
+        void setIncrement( int voice );
+
+        bool getFrame( int_fast32_t voice, int64_t frame, __m128d& value ) throw();
+
+        std::shared_ptr< SampleFile > sample_;
+        std::unique_ptr< SampleStream[] > streams_;     // their rings are in the arena
+        int numStreams_ = 0;
+
+        const float* headLeft_  = nullptr;
+        const float* headRight_ = nullptr;
+        int64_t numFrames_      = 0;
+        int64_t numHeadFrames_  = 0;
+        double rootFreq_        = 261.62557;
+        double rateRatio_       = 1;                    // sample rate of the file / sample rate
+
+        double* position_   = nullptr;                  // frames
+        double* increment_  = nullptr;
+        double* freq_       = nullptr;
+        double* amplitude_  = nullptr;
+        int64_t* streamEnd_ = nullptr;                  // last seen SampleStream::getEnd()
+        uint8_t* playing_   = nullptr;
+        uint8_t* underrun_  = nullptr;
+
+        Inport freqInport_;
+        Inport ampInport_;
+        Outport leftOutport_;
+        Outport rightOutport_;
+    };
+
+
+    // Frames before the start and after the end are silent.
+    __forceinline bool Sampler::getFrame( int_fast32_t voice, int64_t frame, __m128d& value ) throw()
+    {
+        if (frame < numHeadFrames_)
+        {
+            value = (frame >= 0) ? _mm_set_pd( headRight_[frame], headLeft_[frame] ) : _mm_setzero_pd();
+            return true;
+        }
+        if (frame >= numFrames_)
+        {
+            value = _mm_setzero_pd();
+            return true;
+        }
+        if (frame >= streamEnd_[voice])
+        {
+            streamEnd_[voice] = streams_[voice].getEnd();
+            if (frame >= streamEnd_[voice]) return false;
+        }
+        const SampleStream& stream = streams_[voice];
+        value = _mm_set_pd( stream.getRight( frame ), stream.getLeft( frame ) );
+        return true;
+    }
+
+
+    template< bool Mono >
+    inline void Sampler::processAudio() throw()
+    {
+        const __m128d half    = _mm_set1_pd( 0.5 );
+        const __m128d onehalf = _mm_set1_pd( 1.5 );
+        const __m128d two     = _mm_set1_pd( 2 );
+        const __m128d twohalf = _mm_set1_pd( 2.5 );
+
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = Mono ? 0 : polyphony_->soundingVoices_[i];
+            if (playing_[v] == 0) continue;
+
+            double position = position_[v];
+            int64_t frame   = (int64_t)position;
+            if (frame >= numFrames_)
+            {
+                playing_[v] = 0;
+                if (numStreams_ > 0) streams_[v].stop();
+                continue;
+            }
+            position_[v] = position + increment_[v];
+
+            __m128d y0, y1, y2, y3;
+            bool complete =
+                getFrame( v, frame - 1, y0 ) &
+                getFrame( v, frame, y1 ) &
+                getFrame( v, frame + 1, y2 ) &
+                getFrame( v, frame + 2, y3 );
+
+            if (complete == false)
+            {
+                if (underrun_[v] == 0) {
+                    AUDIO_TRACE( AudioTraceError, TraceStreamUnderrun, (double)v, (double)frame );
+                    underrun_[v] = 1;
+                }
+                continue;
+            }
+            underrun_[v] = 0;
+
+            // c0 + x * (c1 + x * (c2 + x * c3))
+            __m128d x  = _mm_set1_pd( position - frame );
+            __m128d c1 = _mm_mul_pd( half, _mm_sub_pd( y2, y0 ) );
+            __m128d c2 = _mm_sub_pd( _mm_add_pd( y0, _mm_mul_pd( two, y2 ) ), _mm_add_pd( _mm_mul_pd( twohalf, y1 ), _mm_mul_pd( half, y3 ) ) );
+            __m128d c3 = _mm_add_pd( _mm_mul_pd( half, _mm_sub_pd( y3, y0 ) ), _mm_mul_pd( onehalf, _mm_sub_pd( y1, y2 ) ) );
+            __m128d y  = _mm_add_pd( _mm_mul_pd( _mm_add_pd( _mm_mul_pd( _mm_add_pd( _mm_mul_pd( c3, x ), c2 ), x ), c1 ), x ), y1 );
+            y          = _mm_mul_pd( y, _mm_set1_pd( amplitude_[v] ) );
+
+            double output[2];
+            _mm_storeu_pd( output, y );
+            leftOutport_.putAudio( output[0], v );
+            rightOutport_.putAudio( output[1], v );
+        }
+    }
+
+} // namespace e3
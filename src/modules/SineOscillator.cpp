@@ -20,8 +20,8 @@ namespace e3 {
         makeWaveTable();
 
         addOutport( 0, "Out", &audioOutport_, PortTypeAudio );
-        addInport( 0, "Freq", &freqInport_ );
-        addInport( 1, "Amp",  &ampInport_ );
+        addInport( 0, "Freq", &freqInport_, &eventSetter< SineOscillator, &SineOscillator::setFrequency > );
+        addInport( 1, "Amp",  &ampInport_,  &eventSetter< SineOscillator, &SineOscillator::setAmplitude > );
     }
 
 
@@ -44,10 +44,10 @@ namespace e3 {
     {
         Module::initData();
 
-        phaseIndex_ = phaseIndexBuffer_.resize( numVoices_, 0. );
-        amplitude_  = amplitudeBuffer_.resize( numVoices_, 1 );
-        increment_  = incrementBuffer_.resize( numVoices_, 20.43356 );	// 440 Hz
-        freq_       = frequencyBuffer_.resize( numVoices_, 440 );
+        phaseIndex_ = allocate< double >( numVoices_, 0. );
+        amplitude_  = allocate< double >( numVoices_, 1 );
+        increment_  = allocate< double >( numVoices_, 20.43356 );	// 440 Hz
+        freq_       = allocate< double >( numVoices_, 440 );
 
         freqInportPointer_ = freqInport_.getAudioBuffer();
         ampInportPointer_  = ampInport_.getAudioBuffer();
@@ -59,18 +59,31 @@ namespace e3 {
         bool fm = freqInport_.getNumAudioConnections() > 0;
         bool am = ampInport_.getNumAudioConnections() > 0;
 
-        if (fm == false && am == false) {
-            processFunction_ = static_cast<ProcessFunctionPointer>(&SineOscillator::processAudio);
-        }
-        else if (fm == true && am == false) {
-            processFunction_ = static_cast<ProcessFunctionPointer>(&SineOscillator::processAudioFm);
-        }
-        else if (fm == false && am == true) {
-            processFunction_ = static_cast<ProcessFunctionPointer>(&SineOscillator::processAudioAm);
-        }
-        else if (fm == true && am == true) {
-            processFunction_ = static_cast<ProcessFunctionPointer>(&SineOscillator::processAudioFmAm);
+        processFunction_ = ProcessFunctionSelector< Kernels >::select( mono_, fm, am );
+    }
+
+
+    bool SineOscillator::isFusableSource() const
+    {
+        return mono_ == false &&
+            freqInport_.getNumAudioConnections() == 0 &&
+            ampInport_.getNumAudioConnections() == 0;
+    }
+
+
+    bool SineOscillator::fuseSource( Module* source, const Link& link )
+    {
+        bool am = ampInport_.getNumAudioConnections() > 0;
+
+        if (link.rightPort_ == ParamFrequency && am == false && mono_ == false &&
+            source->moduleType_ == ModuleTypeSineOscillator)
+        {
+            fusedSource_     = source;
+            fusedModulation_ = source->getOutport( link.leftPort_ )->getAudioModulation();
+            processFunction_ = static_cast<ProcessFunctionPointer>(&SineOscillator::processAudioFused<SineOscillator>);
+            return true;
         }
+        return false;
     }
 
 
@@ -92,33 +105,39 @@ namespace e3 {
         __assume(paramId < 4);
         switch (paramId)
         {
-        case ParamFrequency:
-            if (voice >= 0)
-            {
-                double freq;
-                if (modulation < 0) {
-                    double pitch = FreqToPitch( value );
-                    pitch        = (pitch - 60) * modulation + 60;
-                    freq         = (double)PitchToFreq( pitch );
-                }
-                else {
-                    freq = (value - 261.62557f) * modulation + 261.62557f;
-                }
-                freq_[voice] = freq;
-                setIncrement( voice );
-            }
-            break;
-        case ParamAmplitude:
-            if (voice >= 0)
-                amplitude_[voice] = value * modulation;
-            break;
-
+        case ParamFrequency:  if (voice >= 0) setFrequency( value, modulation, voice ); break;
+        case ParamAmplitude:  if (voice >= 0) setAmplitude( value, modulation, voice ); break;
         case ParamTuning:     setTuning( value ); break;
         case ParamFinetuning: setFineTuning( value ); break;
         }
     }
 
 
+    void SineOscillator::setFrequency( double value, double modulation, int voice )
+    {
+        ASSERT( voice >= 0 && voice < numVoices_ );
+
+        double freq;
+        if (modulation < 0) {
+            double pitch = FreqToPitch( value );
+            pitch        = (pitch - 60) * modulation + 60;
+            freq         = (double)PitchToFreq( pitch );
+        }
+        else {
+            freq = (value - 261.62557f) * modulation + 261.62557f;
+        }
+        freq_[voice] = freq;
+        setIncrement( voice );
+    }
+
+
+    void SineOscillator::setAmplitude( double value, double modulation, int voice )
+    {
+        ASSERT( voice >= 0 && voice < numVoices_ );
+        amplitude_[voice] = value * modulation;
+    }
+
+
     void SineOscillator::setTuning( double paramValue )
     {
         double pitch = (double)(int32_t)paramValue;
@@ -156,117 +175,4 @@ namespace e3 {
         ASSERT( table_ );
     }
 
-
-    void SineOscillator::processAudio() throw()
-    {
-        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
-        int_fast32_t v;
-        int_fast32_t index, i;
-        double tick, frac, pos;
-
-        for (i = 0; i < maxVoices; i++)
-        {
-            v   = mono_ ? 0 : polyphony_->soundingVoices_[i];
-            pos = phaseIndex_[v];
-
-            while (pos < 0.0) pos += tableSize_;         // Check limits of table address
-            while (pos >= tableSize_) pos -= tableSize_;
-
-            index = (uint32_t)pos;
-            frac  = pos - index;
-            tick  = table_[index];
-            tick += amplitude_[v] * frac * (table_[index + 1] - tick);
-
-            phaseIndex_[v] = pos + increment_[v];
-            audioOutport_.putAudio( tick, v );
-        }
-    }
-
-
-    void SineOscillator::processAudioFm()
-    {
-        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
-        int_fast32_t v;
-        double tick, pos, frac;
-        int_fast32_t index, i;
-
-        for (i = 0; i < maxVoices; i++)
-        {
-            v   = mono_ ? 0 : polyphony_->soundingVoices_[i];
-            pos = phaseIndex_[v];
-
-            pos += freqInportPointer_[v];							// FM
-            freqInportPointer_[v] = 0.f;
-
-            while (pos < 0.0) pos += tableSize_;         // Check limits of table address
-            while (pos >= tableSize_) pos -= tableSize_;
-
-            index = (int_fast32_t)pos;
-            frac  = pos - index;
-            tick  = table_[index];
-            tick += amplitude_[v] * frac * (table_[index + 1] - tick);
-
-            phaseIndex_[v] = pos + increment_[v];
-            audioOutport_.putAudio( tick, v );
-        }
-    }
-
-
-    void SineOscillator::processAudioAm()
-    {
-        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
-        int_fast32_t v;
-        double tick, pos, frac;
-        int_fast32_t index, i;
-
-        for (i = 0; i < maxVoices; i++)
-        {
-            v   = mono_ ? 0 : polyphony_->soundingVoices_[i];
-            pos = phaseIndex_[v];
-
-            while (pos < 0) pos += tableSize_;         // Check limits of table address
-            while (pos >= tableSize_) pos -= tableSize_;
-
-            index = (int_fast32_t)pos;
-            frac  = pos - index;
-            tick  = table_[index];
-            tick += frac * (table_[index + 1] - tick);
-            tick *= amplitude_[v] + ampInportPointer_[v];
-            ampInportPointer_[v] = 0;
-
-            phaseIndex_[v] = pos + increment_[v];                     // table position, which can be negative.
-            audioOutport_.putAudio( tick, v );
-        }
-    }
-
-
-    void SineOscillator::processAudioFmAm()
-    {
-        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
-        double tick, pos, frac;
-        int_fast32_t index, i;
-        int_fast32_t v;
-
-        for (i = 0; i < maxVoices; i++)
-        {
-            v = mono_ ? 0 : polyphony_->soundingVoices_[i];
-            pos = phaseIndex_[v];
-
-            pos += freqInportPointer_[v];                         // FM
-            freqInportPointer_[v] = 0.f;
-
-            while (pos < 0.0) pos += tableSize_;         // Check limits of table address
-            while (pos >= tableSize_) pos -= tableSize_;
-
-            index = (int_fast32_t)pos;
-            frac = pos - index;
-            tick = table_[index];
-            tick += frac * (table_[index + 1] - tick);
-            tick *= amplitude_[v] + ampInportPointer_[v];
-            ampInportPointer_[v] = 0.f;
-
-            phaseIndex_[v] = pos + increment_[v];
-            audioOutport_.putAudio( tick, v );
-        }
-    }
 } // namespace e3
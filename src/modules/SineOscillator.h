@@ -4,6 +4,7 @@
 
 #include <string>
 #include "core/Module.h"
+#include "core/Polyphony.h"
 
 
 namespace e3 {
@@ -18,11 +19,28 @@ namespace e3 {
         void updatePorts() override;
 
         void setParameter(int paramId, double value, double modulation=0.f, int voice=-1) override;
+        void setFrequency( double value, double modulation, int voice );
+        void setAmplitude( double value, double modulation, int voice );
 
-        void processAudio() throw();
-        void processAudioFm();
-        void processAudioAm();
-        void processAudioFmAm();
+        // Fm, Am: the Freq or Amp inport has audio connections.
+        template< bool Mono, bool Fm, bool Am > void processAudio() throw();
+
+        // Fused kernel: the phase is modulated by a source feeding the Freq inport.
+        template< class Source > void processAudioFused() throw();
+
+        // Computes the next sample of an oscillator without audio inputs.
+        double tick( int_fast32_t voice ) throw();
+
+        struct Kernels
+        {
+            template< bool Mono, bool Fm, bool Am > static ProcessFunctionPointer get()
+            {
+                return static_cast<ProcessFunctionPointer>(&SineOscillator::processAudio< Mono, Fm, Am >);
+            }
+        };
+
+        bool isFusableSource() const override;
+        bool fuseSource( Module* source, const Link& link ) override;
 
         enum ParamId {
             ParamFrequency   = 0,
@@ -31,8 +49,6 @@ namespace e3 {
             ParamFinetuning  = 3,
         };
 
-        std::string debugLabel_ = "SineOscillator";
-
     protected:
         void setSampleRate(double sampleRate) override;
         void setTuning( double paramValue );
@@ -41,8 +57,12 @@ namespace e3 {
 
         void makeWaveTable();
 
-        Buffer<double> incrementBuffer_, phaseIndexBuffer_, amplitudeBuffer_, frequencyBuffer_;
-        double *phaseIndex_, *amplitude_, *increment_, *freq_;
+        template< bool Am > double lookup( int_fast32_t voice, double phaseOffset ) throw();
+
+        double* phaseIndex_ = nullptr;
+        double* amplitude_  = nullptr;
+        double* increment_  = nullptr;
+        double* freq_       = nullptr;
         
         double tuning_ = 1;
         double fineTuning_ = 1;
@@ -64,5 +84,68 @@ namespace e3 {
         increment_[voice] = (tableSize_ * freq_[voice] * tuning_ * fineTuning_) / sampleRate_;
     }
 
+
+    template< bool Am >
+    __forceinline double SineOscillator::lookup( int_fast32_t v, double phaseOffset ) throw()
+    {
+        double pos = phaseIndex_[v] + phaseOffset;
+
+        while (pos < 0.0) pos += tableSize_;         // Check limits of table address
+        while (pos >= tableSize_) pos -= tableSize_;
+
+        int_fast32_t index = (int_fast32_t)pos;
+        double frac        = pos - index;
+        double tick        = table_[index];
+        tick += frac * (table_[index + 1] - tick);
+
+        double amplitude = amplitude_[v];
+        if (Am) {
+            amplitude += ampInportPointer_[v];
+            ampInportPointer_[v] = 0;
+        }
+        phaseIndex_[v] = pos + increment_[v];        // table position, which can be negative.
+        return tick * amplitude;
+    }
+
+
+    __forceinline double SineOscillator::tick( int_fast32_t v ) throw()
+    {
+        return lookup< false >( v, 0 );
+    }
+
+
+    template< bool Mono, bool Fm, bool Am >
+    inline void SineOscillator::processAudio() throw()
+    {
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = Mono ? 0 : polyphony_->soundingVoices_[i];
+            double fm      = 0;
+            if (Fm) {
+                fm = freqInportPointer_[v];
+                freqInportPointer_[v] = 0;
+            }
+            audioOutport_.putAudio( lookup< Am >( v, fm ), v );
+        }
+    }
+
+
+    template< class Source >
+    inline void SineOscillator::processAudioFused() throw()
+    {
+        Source* source         = static_cast<Source*>(fusedSource_);
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = polyphony_->soundingVoices_[i];
+            double fm      = source->tick( v ) * fusedModulation_[v];     // modulator stays in registers
+
+            audioOutport_.putAudio( lookup< false >( v, fm ), v );
+        }
+    }
+
 } // namespace e3
 
@@ -0,0 +1,169 @@
+
+#include <cmath>
+#include <e3_Math.h>
+#include <e3_Exception.h>
+#include "core/Polyphony.h"
+#include "modules/SvfFilter.h"
+
+
+namespace e3 {
+
+    SvfFilter::SvfFilter() : Module(
+        ModuleTypeSvfFilter,
+        "Filter",
+        Polyphonic,
+        (ProcessingType)(ProcessEvent | ProcessControl | ProcessAudio) )
+    {
+        addInport( 0, "In", &audioInport_ );
+        addInport( 1, "Cutoff", &cutoffInport_, &eventSetter< SvfFilter, &SvfFilter::setKeyTracking > );
+        addInport( 2, "Reso", &resonanceInport_, &eventSetter< SvfFilter, &SvfFilter::setVoiceResonance > );
+        addOutport( 0, "Out", &audioOutport_, PortTypeAudio );
+    }
+
+
+    ParameterSet& SvfFilter::getDefaultParameters() const
+    {
+        static ParameterSet set;
+        set.clear();
+
+        const Parameter& paramMode = set.addModuleParameter( ParamMode, id_, "Mode", ControlNumEdit, ModeLowpass );
+        paramMode.valueShaper_ = { 0, 3, 3 };
+        paramMode.numberFormat_ = NumberInt;
+
+        const Parameter& paramCutoff = set.addModuleParameter( ParamCutoff, id_, "Cutoff", ControlSlider, 20000 );
+        paramCutoff.valueShaper_ = { 20, 20000, 1000, 12 };
+        paramCutoff.unit_ = "Hz";
+        paramCutoff.numberFormat_ = NumberInt;
+
+        const Parameter& paramResonance = set.addModuleParameter( ParamResonance, id_, "Resonance", ControlSlider, 0 );
+        paramResonance.valueShaper_ = { 0, 1, 100 };
+
+        return set;
+    }
+
+
+    void SvfFilter::initData()
+    {
+        Module::initData();
+
+        gTable_    = allocate< double >( TableSize, 0 );
+        ic1eq_     = allocate< double >( numVoices_, 0 );
+        ic2eq_     = allocate< double >( numVoices_, 0 );
+        keyPitch_  = allocate< double >( numVoices_, 0 );
+        voiceReso_ = allocate< double >( numVoices_, 0 );
+        a1_        = allocate< double >( numVoices_, 1 );
+        a2_        = allocate< double >( numVoices_, 0 );
+        a3_        = allocate< double >( numVoices_, 0 );
+        k_         = allocate< double >( numVoices_, 2 );
+
+        audioInportPointer_     = audioInport_.getAudioBuffer();
+        cutoffInportPointer_    = cutoffInport_.getAudioBuffer();
+        resonanceInportPointer_ = resonanceInport_.getAudioBuffer();
+        dirty_ = true;
+    }
+
+
+    void SvfFilter::updatePorts()
+    {
+        bool modulated = 
+            cutoffInport_.getNumAudioConnections() > 0 || 
+            resonanceInport_.getNumAudioConnections() > 0;
+
+        processFunction_ = ProcessFunctionSelector< Kernels >::select( mono_, modulated );
+    }
+
+
+    // Frequencies near Nyquist are limited, tan() grows without bound there.
+    void SvfFilter::setSampleRate( double sampleRate )
+    {
+        Module::setSampleRate( sampleRate );
+
+        for (int i = 0; i < TableSize; i++)
+        {
+            double freq = std::min<double>( PitchToFreq( (double)i / Resolution ), sampleRate_ * 0.49 );
+            gTable_[i]  = tan( PI * freq / sampleRate_ );
+        }
+        dirty_ = true;
+    }
+
+
+    void SvfFilter::processControl() throw()
+    {
+        if (dirty_ == false) return;
+        dirty_ = false;
+
+        for (int v = 0; v < numVoices_; v++) {
+            updateCoefficients( v );
+        }
+    }
+
+
+    void SvfFilter::updateCoefficients( int v )
+    {
+        double g = lookupG( pitch_ + keyPitch_[v] );
+        k_[v]    = getDamping( resonance_ + voiceReso_[v] );
+        a1_[v]   = 1 / (1 + g * (g + k_[v]));
+        a2_[v]   = g * a1_[v];
+        a3_[v]   = g * a2_[v];
+    }
+
+
+    // A new note starts from silence, its voice may have filtered another note before.
+    void SvfFilter::processVoiceEvents( const VoiceEventList& events )
+    {
+        for (VoiceEventList::const_iterator e = events.begin(); e != events.end(); ++e)
+        {
+            if (e->type_ == VoiceEvent::Note && e->gateChanged_ && e->gate_ > 0 && e->voice_ < numVoices_) {
+                ic1eq_[e->voice_] = 0;
+                ic2eq_[e->voice_] = 0;
+            }
+        }
+    }
+
+
+    void SvfFilter::setParameter( int paramId, double value, double modulation, int voice )
+    {
+        voice = std::min<int>( numVoices_ - 1, voice );
+
+        switch (paramId)
+        {
+        case ParamCutoffIn:    if (voice >= 0) setKeyTracking( value, modulation, voice ); break;
+        case ParamResonanceIn: if (voice >= 0) setVoiceResonance( value, modulation, voice ); break;
+        case ParamMode:        setMode( (int)value ); break;
+        case ParamCutoff:      pitch_ = FreqToPitch( std::max<double>( 1, value ) ); dirty_ = true; break;
+        case ParamResonance:   resonance_ = value; dirty_ = true; break;
+        }
+    }
+
+
+    // The frequency of the note moves the cutoff by its distance to C4, scaled by the link.
+    void SvfFilter::setKeyTracking( double value, double modulation, int voice )
+    {
+        ASSERT( voice >= 0 && voice < numVoices_ );
+        keyPitch_[voice] = (FreqToPitch( std::max<double>( 1, value ) ) - 60) * modulation;
+        updateCoefficients( voice );
+    }
+
+
+    void SvfFilter::setVoiceResonance( double value, double modulation, int voice )
+    {
+        ASSERT( voice >= 0 && voice < numVoices_ );
+        voiceReso_[voice] = value * modulation;
+        updateCoefficients( voice );
+    }
+
+
+    void SvfFilter::setMode( int mode )
+    {
+        mixIn_ = mixDamping_ = mixLow_ = 0;
+
+        switch (mode)
+        {
+        case ModeHighpass: mixIn_ = 1; mixDamping_ = 1; mixLow_ = -1; break;
+        case ModeBandpass: mixDamping_ = -1; break;         // k * band, unity gain at the cutoff
+        case ModeNotch:    mixIn_ = 1; mixDamping_ = 1; break;
+        default:           mixLow_ = 1; break;
+        }
+    }
+
+} // namespace e3
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <string>
+#include "core/Module.h"
+#include "core/Polyphony.h"
+
+
+namespace e3 {
+
+    //--------------------------------------------------------------------------
+    // class SvfFilter
+    // State variable filter in the zero-delay-feedback (trapezoidal) form
+    // after Andrew Simper, with lowpass, highpass, bandpass and notch output.
+    // The cutoff is handled as pitch: the Cutoff parameter, plus key tracking
+    // from events at the Cutoff inport, plus audio at the Cutoff inport, where
+    // 1 shifts the cutoff by ModRange semitones. The warped coefficient of a
+    // pitch comes from a table built for the sample rate.
+    // Without audio modulation, the coefficients of all voices are updated at
+    // control rate when something changed, and the kernel only filters.
+    // The mode selects the mix of the outputs, so one kernel serves all modes.
+    //--------------------------------------------------------------------------
+
+    class SvfFilter : public Module
+    {
+    public:
+        SvfFilter();
+
+        ParameterSet& getDefaultParameters() const override;
+        void initData() override;
+        void updatePorts() override;
+        void processControl() throw() override;
+        void processVoiceEvents( const VoiceEventList& events ) override;
+
+        void setParameter( int paramId, double value, double modulation = 0.f, int voice = -1 ) override;
+        void setKeyTracking( double value, double modulation, int voice );
+        void setVoiceResonance( double value, double modulation, int voice );
+
+        // Modulated: the Cutoff or Reso inport has audio connections.
+        template< bool Mono, bool Modulated > void processAudio() throw();
+
+        struct Kernels
+        {
+            template< bool Mono, bool Modulated > static ProcessFunctionPointer get()
+            {
+                return static_cast<ProcessFunctionPointer>(&SvfFilter::processAudio< Mono, Modulated >);
+            }
+        };
+
+        enum ParamId {
+            ParamAudioIn     = 0,
+            ParamCutoffIn    = 1,       // events: key tracking, audio: cutoff modulation
+            ParamResonanceIn = 2,
+            ParamMode        = 3,
+            ParamCutoff      = 4,
+            ParamResonance   = 5
+        };
+
+        enum Mode {
+            ModeLowpass  = 0,
+            ModeHighpass = 1,
+            ModeBandpass = 2,
+            ModeNotch    = 3
+        };
+
+        enum {
+            MaxPitch   = 136,           // 20.9 kHz
+            Resolution = 4,             // table entries per semitone
+            TableSize  = MaxPitch * Resolution + 2,
+            ModRange   = 48             // semitones for an audio input of 1
+        };
+
+    protected:
+        void setSampleRate( double sampleRate ) override;
+        void setMode( int mode );
+        void updateCoefficients( int voice );
+
+        double lookupG( double pitch ) const throw();
+        double getDamping( double resonance ) const throw()     { return 2 - 1.98 * std::max<double>( 0, std::min<double>( 1, resonance ) ); }
+
+        double pitch_     = 135;        // the Cutoff parameter
+        double resonance_ = 0;
+        bool dirty_       = true;
+
+        // output = mixIn_ * in - mixDamping_ * k * band + mixLow_ * low
+        double mixIn_      = 0;
+        double mixDamping_ = 0;
+        double mixLow_     = 1;
+
+        double* gTable_     = nullptr;  // tan( PI * f / fs ), per 1 / Resolution semitones
+        double* ic1eq_      = nullptr;
+        double* ic2eq_      = nullptr;
+        double* keyPitch_   = nullptr;
+        double* voiceReso_  = nullptr;
+        double* a1_         = nullptr;
+        double* a2_         = nullptr;
+        double* a3_         = nullptr;
+        double* k_          = nullptr;
+
+        Inport audioInport_;
+        Inport cutoffInport_;
+        Inport resonanceInport_;
+        Outport audioOutport_;
+        double* audioInportPointer_     = nullptr;
+        double* cutoffInportPointer_    = nullptr;
+        double* resonanceInportPointer_ = nullptr;
+    };
+
+
+    __forceinline double SvfFilter::lookupG( double pitch ) const throw()
+    {
+        double pos = std::max<double>( 0, std::min<double>( MaxPitch, pitch ) ) * Resolution;
+        int index  = (int)pos;
+        double g   = gTable_[index];
+        return g + (pos - index) * (gTable_[index + 1] - g);
+    }
+
+
+    template< bool Mono, bool Modulated >
+    inline void SvfFilter::processAudio() throw()
+    {
+        int_fast32_t maxVoices = std::min<int_fast32_t>( numVoices_, polyphony_->numSounding_ );
+
+        for (int_fast32_t i = 0; i < maxVoices; i++)
+        {
+            int_fast32_t v = Mono ? 0 : polyphony_->soundingVoices_[i];
+            double input   = audioInportPointer_[v];
+            audioInportPointer_[v] = 0;
+
+            double a1, a2, a3, k;
+            if (Modulated)
+            {
+                double g = lookupG( pitch_ + keyPitch_[v] + cutoffInportPointer_[v] * ModRange );
+                k        = getDamping( resonance_ + voiceReso_[v] + resonanceInportPointer_[v] );
+                a1       = 1 / (1 + g * (g + k));
+                a2       = g * a1;
+                a3       = g * a2;
+                cutoffInportPointer_[v]    = 0;
+                resonanceInportPointer_[v] = 0;
+            }
+            else {
+                a1 = a1_[v];
+                a2 = a2_[v];
+                a3 = a3_[v];
+                k  = k_[v];
+            }
+
+            double v3 = input - ic2eq_[v];
+            double v1 = a1 * ic1eq_[v] + a2 * v3;               // band
+            double v2 = ic2eq_[v] + a2 * ic1eq_[v] + a3 * v3;   // low
+            ic1eq_[v] = 2 * v1 - ic1eq_[v];
+            ic2eq_[v] = 2 * v2 - ic2eq_[v];
+
+            double output = mixIn_ * input - mixDamping_ * k * v1 + mixLow_ * v2;
+            audioOutport_.putAudio( output, v );
+        }
+    }
+
+} // namespace e3